@@ -17,16 +17,33 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "mrhs.bm.h"
+#include "mrhs.simd.h"
 #include "mrhs.solver.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // BBM Constructors and destructors
 
+//storage of rows: one aligned slab, rows are ROW_STRIDE(nblocks) blocks apart
+static void alloc_bbm_rows(_bbm *pbbm)
+{
+    int i;
+
+    pbbm->stride = ROW_STRIDE(pbbm->nblocks);
+    pbbm->slab = (_block*) calloc_aligned((size_t) pbbm->nrows * pbbm->stride, sizeof(_block));
+    pbbm->rows = (_block**) malloc(pbbm->nrows * sizeof(_block*));
+    for (i = 0; i < pbbm->nrows; i++) {
+        pbbm->rows[i] = pbbm->slab + (size_t) i * pbbm->stride;
+    }
+}
+
 /// Creates a dynamic BlockBitMatrix with nrows and nblocks, 
 ///   each with the same blocksize, blocks filled with zeroes
-/// alloc: array of pointers
+/// alloc: array of row pointers into one aligned slab
 /// PRE: nblocks > 0, 0 < blocksize <= MAXBLOCKSIZE, nrows > 0
 _bbm* create_bbm(int nrows, int nblocks, int blocksize)
 {
@@ -47,10 +64,7 @@ _bbm* create_bbm(int nrows, int nblocks, int blocksize)
     }
 
     pbbm->nrows      = nrows;
-    pbbm->rows = (_block**) malloc(nrows * sizeof(_block*));
-    for (i = 0; i < nrows; i++) {
-        pbbm->rows[i] = (_block*) calloc(nblocks, sizeof(_block));
-    }
+    alloc_bbm_rows(pbbm);
     pbbm->weights    = (int*) malloc(nrows * sizeof(int));
     
     return pbbm;
@@ -58,7 +72,7 @@ _bbm* create_bbm(int nrows, int nblocks, int blocksize)
 
 /// Creates a dynamic BlockBitMatrix with nrows and nblocks, 
 ///   each with the same blocksize, blocks filled with zeroes
-/// alloc: array of pointers
+/// alloc: array of row pointers into one aligned slab
 /// PRE: nblocks > 0, 0 < blocksize <= MAXBLOCKSIZE, nrows > 0
 _bbm* create_bbm_new(int nrows, int nblocks, int blocksizes[])
 {
@@ -79,10 +93,8 @@ _bbm* create_bbm_new(int nrows, int nblocks, int blocksizes[])
     }
 
     pbbm->nrows      = nrows;
-    pbbm->rows = (_block**) malloc(nrows * sizeof(_block*));
-    for (i = 0; i < nrows; i++) {
-        pbbm->rows[i] = (_block*) calloc(nblocks, sizeof(_block));
-    }
+    alloc_bbm_rows(pbbm);
+    pbbm->weights    = NULL;
     
     return pbbm;
 }
@@ -90,15 +102,12 @@ _bbm* create_bbm_new(int nrows, int nblocks, int blocksizes[])
 ///free space allocated to internal _bbm structures
 void free_bbm(_bbm* pbbm)
 {
-    int i; 
-    for (i = 0; i < pbbm->nrows; i++) {
-        free(pbbm->rows[i]);
-    }    
+    free_aligned(pbbm->slab);
     free(pbbm->rows);
    
     free(pbbm->pivots);
     free(pbbm->blocksizes);
-    //free(pbbm->weights);
+    free(pbbm->weights);
 
     free(pbbm);
 }
@@ -115,7 +124,7 @@ void add_row(_bbm *pbbm, int to, int to_add)
     }
 }
 
-///swaps rows i and j
+///swaps rows i and j (only row pointers, slab is not changed)
 void swap_row(_bbm *pbbm, int i, int j)
 {
      _block* tmp   = pbbm->rows[i]; 
@@ -153,38 +162,229 @@ int find_pivot(_bbm *pbbm, int block, _block mask, int from)
     return -1;
 }
 
+//transformation A (nrows x nrows) packed: column j is bit j % MAXBLOCKSIZE of block j / MAXBLOCKSIZE
+static _bbm* create_a(int nrows)
+{
+    _bbm *pA;
+    int i, words = GET_NUM_BLOCKS(nrows);
+    int *blocksizes = (int*) malloc(words * sizeof(int));
+
+    for (i = 0; i < words; i++)
+        blocksizes[i] = (i < words - 1) ? MAXBLOCKSIZE : LASTBLOCKSIZE(nrows);
+    pA = create_bbm_new(nrows, words, blocksizes);
+    free(blocksizes);
+    return pA;
+}
+
+//linear map of columns of a block: image of x is xor of images of its bits, 8 bits per table
+// (nbytes == 0: identity)
+typedef struct {
+    int nbytes;
+    _block table[MAXBLOCKSIZE / 8][256];
+} ColumnMap;
+
+static void build_column_map(ColumnMap *map, const _block *images, int bits)
+{
+    int k, v, bit, size;
+
+    for (bit = 0; bit < bits; bit++)
+        if (images[bit] != (ONE << bit))
+            break;
+    if (bit == bits)
+    {
+        map->nbytes = 0;
+        return;
+    }
+
+    map->nbytes = (bits + 7) / 8;
+    for (k = 0; k < map->nbytes; k++)
+    {
+        size = 1 << ((bits - 8 * k < 8) ? bits - 8 * k : 8);
+        map->table[k][0] = ZERO;
+        for (v = 1; v < size; v++)
+        {
+            for (bit = 0; ((v >> bit) & 1) == 0; bit++)
+                ;
+            map->table[k][v] = map->table[k][v & (v - 1)] ^ images[8 * k + bit];
+        }
+    }
+}
+
+static _block apply_column_map(const ColumnMap *map, _block x)
+{
+    _block y = ZERO;
+    int k;
+
+    for (k = 0; k < map->nbytes; k++, x >>= 8)
+        y ^= map->table[k][x & 0xff];
+    return y;
+}
+
+static _block swap_bits(_block data, int col1, int col2)
+{
+    _block mask = ((ONE)<<col1) | ((ONE)<<col2);
+    return data ^ ( ((data >> col1)^(data>>col2))&ONE )*mask;
+}
+
+//column operations of echelonized block as maps of M (permutation) and RHS (with column additions):
+// pivot columns (pivcols) are swapped to the start of block, redundant part of pivot rows is 
+// removed by adding pivot columns (RHS only, we get (I | 0)), pivots are moved to MSB part
+static void prepare_column_maps(_bbm *pbbm, int block, int oldrank, const int *pivcols, ColumnMap *mapM, ColumnMap *mapS)
+{
+    _block imagesM[MAXBLOCKSIZE], imagesS[MAXBLOCKSIZE], rows[MAXBLOCKSIZE], v;
+    int i, j, pivot;
+    int bits = pbbm->blocksizes[block], pivots = pbbm->pivots[block];
+    int offset = bits - pivots;
+
+    //pivot rows with pivot columns at the start
+    for (pivot = 0; pivot < pivots; pivot++)
+    {
+        rows[pivot] = pbbm->rows[oldrank+pivot][block];
+        for (i = 0; i < pivots; i++)
+            if (pivcols[i] > i)
+                rows[pivot] = swap_bits(rows[pivot], pivcols[i], i);
+    }
+
+    for (j = 0; j < bits; j++)
+    {
+        v = ONE << j;
+        for (i = 0; i < pivots; i++)
+            if (pivcols[i] > i)
+                v = swap_bits(v, pivcols[i], i);
+        imagesM[j] = imagesS[j] = v;
+
+        //remove selected column from each sol: column j ^= column pivot
+        for (pivot = 0; pivot < pivots; pivot++)
+            if ((imagesS[j] >> pivot) & ONE)
+                imagesS[j] ^= rows[pivot] & ~BLOCK_MASK(pivots);
+
+        //move pivots to MSB part
+        if (offset > 0)
+            for (i = pivots - 1; i >= 0; i--)
+            {
+                imagesM[j] = swap_bits(imagesM[j], i, i + offset);
+                imagesS[j] = swap_bits(imagesS[j], i, i + offset);
+            }
+    }
+    build_column_map(mapM, imagesM, bits);
+    build_column_map(mapS, imagesS, bits);
+}
+
+//max. bits of tables of pivot rows in prepare (Method of Four Russians)
+#define SM_TABLE_BITS 8
+
+//max. pivot rows combined in one table of echelonize (Method of Four Russians)
+#define ECHELON_K 8
+//sweep of rows by the table is split between threads from this number of rows
+#define ECHELON_PARALLEL_ROWS 512
+
+//row ^= other in working matrix of echelonize, stride words
+static void add_wrow(_block *row, const _block *other, int stride)
+{
+    int i;
+    if (stride >= XOR_VECTOR)
+        xor_rows(row, row, other, stride);
+    else
+        for (i = 0; i < stride; i++)
+            row[i] ^= other[i];
+}
+
+//reduces row by t pivot rows of the strip (columns cols of block), pivot rows are reduced among themselves
+static void reduce_strip(_block *row, _block **strip, const int *cols, int t, int block, int stride)
+{
+    int i;
+    for (i = 0; i < t; i++)
+        if ((row[block] >> cols[i]) & ONE)
+            add_wrow(row, strip[i], stride);
+}
+
+//reduces all rows except the strip by table of 2^t combinations of its pivot rows (Gray code order)
+static void flush_strip(_block **wrows, int nrows, int rank0, const int *cols, int t, int block, int stride,
+                        _block *table)
+{
+    int i, bit, g, prev = 0;
+
+    for (i = 1; i < (1 << t); i++)
+    {
+        //one row added per entry: Gray code changes bit of lowest set bit of i
+        g = i ^ (i >> 1);
+        for (bit = 0; ((i >> bit) & 1) == 0; bit++)
+            ;
+        memcpy(table + (size_t) g * stride, table + (size_t) prev * stride, stride * sizeof(_block));
+        add_wrow(table + (size_t) g * stride, wrows[rank0 + bit], stride);
+        prev = g;
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (nrows >= ECHELON_PARALLEL_ROWS)
+#endif
+    for (i = 0; i < nrows; i++)
+    {
+        int c, index = 0;
+        if (i >= rank0 && i < rank0 + t)
+            continue;
+        for (c = 0; c < t; c++)
+            index |= (int) ((wrows[i][block] >> cols[c]) & ONE) << c;
+        if (index != 0)
+            add_wrow(wrows[i], table + (size_t) index * stride, stride);
+    }
+}
+
 /// Creates an echelon form of matrix and computes number of pivots
 ///  swaps columns so that pivots form identity matrix at the start of block
 /// if rhs pointer is non-zero, swaps columns also in rhs(must have same blocks)
 /// NOTE: pivots are moved to MSB part, so that LSB part can be used as an index
+/// rows of M and A are reduced in a contiguous aligned copy, up to ECHELON_K pivots 
+///  of a block at once (Method of Four Russians), pivot rows and A are the same as 
+///  with reduction by single pivot rows
+/// if pA is non-zero, *pA is the transformation, rows packed to blocks of MAXBLOCKSIZE columns
 //TODO: rhs is a list of RHSs, each with a different number of rows 
 int echelonize(_bbm *pbbm, _bbm *rhs[], _bbm **pA)
 {
      //ASSERT (rhs != NULL)
      //ASSERT: rhs is an array of matrices, single block each, variable number of rows
      //ASSERT: len(rhs) = pbbm->nblocks
-     int rank = 0, block = 0, i, j, k, pivot, oldrank = 0, offset;
-     _block mask, mask2;
-     
-     if (pA != NULL)
+     int rank = 0, block = 0, i, j, k, pivot, oldrank = 0, offset, nblocks, t;
+     int cols[ECHELON_K];
+     int *pivcols;
+     _block mask;
+     ColumnMap *maps;
+     _block *slab, *table, **wrows, *tmp;
+     int awords = (pA != NULL) ? GET_NUM_BLOCKS(pbbm->nrows) : 0;
+     int stride = ROW_STRIDE(pbbm->nblocks + awords);
+
+     //working matrix: row i = (M row i | A row i packed to bits), A starts as unit matrix
+     slab  = (_block*) calloc_aligned((size_t) pbbm->nrows * stride, sizeof(_block));
+     wrows = (_block**) malloc(pbbm->nrows * sizeof(_block*));
+     for (i = 0; i < pbbm->nrows; i++)
      {
-        //create unit matrix "A" - for getting back the solution
-        *pA = create_bbm(pbbm->nrows, pbbm->nrows, 1);
-        for (block = 0; block < pbbm->nrows; block++)
-            (*pA)->rows[block][block] = ONE;    
-        
+         wrows[i] = slab + (size_t) i * stride;
+         memcpy(wrows[i], pbbm->rows[i], pbbm->nblocks * sizeof(_block));
+         if (pA != NULL)
+             wrows[i][pbbm->nblocks + i / MAXBLOCKSIZE] = ONE << (i % MAXBLOCKSIZE);
      }
+     table   = (_block*) calloc_aligned((size_t) stride << ECHELON_K, sizeof(_block));
+     pivcols = (int*) malloc((size_t) pbbm->nblocks * MAXBLOCKSIZE * sizeof(int));
+     init_xor_rows();
+
      block = 0;
      while (rank < pbbm->nrows && block < pbbm->nblocks)
      {     
        //TODO: ASSERT(pbbm->pivots[block] == 0)
        pbbm->pivots[block] = 0;
+       oldrank = rank;
+       t = 0;
 
        for (j = 0, mask = ONE; j < pbbm->blocksizes[block]; j++, mask <<= 1)
        {
-           pivot = find_pivot(pbbm, block, mask, rank);
-           
-           if (pivot < 0)
+           //first row from rank with non-zero bit j after reduction by pivots of the strip
+           for (pivot = rank; pivot < pbbm->nrows; pivot++)
+           {
+               reduce_strip(wrows[pivot], wrows + rank - t, cols, t, block, stride);
+               if (wrows[pivot][block] & mask)
+                   break;
+           }
+           if (pivot == pbbm->nrows)
            {
               continue;
            }
@@ -192,69 +392,73 @@ int echelonize(_bbm *pbbm, _bbm *rhs[], _bbm **pA)
            //move pivot row to required position
            if (pivot != rank)
            {
-               swap_row(pbbm, pivot, rank);
-               if (pA != NULL)
-                   swap_row(*pA, pivot, rank);
-           }
-               
-           //now reduce with row at rank index
-           for (i = 0; i < pbbm->nrows; i++)
-           {
-               if (i == rank) continue;
-               if (pbbm->rows[i][block]&mask)
-               {
-                   add_row(pbbm, i, rank);
-                   if (pA != NULL)
-                       add_row(*pA, i, rank);
-               }
+               tmp = wrows[pivot];
+               wrows[pivot] = wrows[rank];
+               wrows[rank] = tmp;
            }
+
+           //keep pivot rows of the strip reduced
+           for (i = rank - t; i < rank; i++)
+               if (wrows[i][block] & mask)
+                   add_wrow(wrows[i], wrows[rank], stride);
+           cols[t++] = j;
                      
-           //perform swap if required
-           if (j > pbbm->pivots[block])
-           {
-               swap_cols(pbbm, block, j, pbbm->pivots[block]);
-               swap_cols(rhs[block], 0, j, pbbm->pivots[block]);
-           }
+           //columns are swapped later, the same way
+           pivcols[block * MAXBLOCKSIZE + pbbm->pivots[block]] = j;
            //update npivots
            pbbm->pivots[block]++;
 
            rank++;    
-       }      
 
-       //all done, zero out redundant part of block's matrix
-       // we get (I | 0) in pivot part of the block
-       for (pivot = 0, mask = ONE; //first pivot in LSB
-                     pivot < pbbm->pivots[block]; pivot++, mask <<= 1)
-       {
-           for (j = pbbm->pivots[block]; j < pbbm->blocksizes[block]; j++)
+           if (t == ECHELON_K)
            {
-               mask2 = ONE << j;
-               if ( (mask2&pbbm->rows[oldrank+pivot][block]) )
-               {
-                    //remove selected column from each sol
-                    pbbm->rows[oldrank+pivot][block] ^= mask2;
-                    for (k = 0; k < rhs[block]->nrows; k++)
-                         rhs[block]->rows[k][0] ^= (mask&rhs[block]->rows[k][0])<<(j-pivot);
-               }
+               flush_strip(wrows, pbbm->nrows, rank - t, cols, t, block, stride, table);
+               t = 0;
            }
-       }
-   
-       //move pivots to MSB part
-       offset = pbbm->blocksizes[block] - pbbm->pivots[block];
-       if (offset > 0)
+       }      
+       if (t > 0)
+           flush_strip(wrows, pbbm->nrows, rank - t, cols, t, block, stride, table);
+       
+       block++;
+     }
+     nblocks = block;
+
+     //copy back M and A
+     for (i = 0; i < pbbm->nrows; i++)
+         memcpy(pbbm->rows[i], wrows[i], pbbm->nblocks * sizeof(_block));
+     if (pA != NULL)
+     {
+        *pA = create_a(pbbm->nrows);
+        for (i = 0; i < pbbm->nrows; i++)
+            memcpy((*pA)->rows[i], wrows[i] + pbbm->nblocks, awords * sizeof(_block));
+     }
+     free_aligned(table);
+     free_aligned(slab);
+     free(wrows);
+
+     //column operations of each block: they do not change rows of other blocks
+     maps = (ColumnMap*) malloc(2 * sizeof(ColumnMap));
+     oldrank = 0;
+     for (block = 0; block < nblocks; block++)
+     {
+       prepare_column_maps(pbbm, block, oldrank, pivcols + block * MAXBLOCKSIZE, &maps[0], &maps[1]);
+       if (maps[0].nbytes > 0)
        {
-           for (j = pbbm->pivots[block] - 1; j >= 0; j--)
-           {
-               swap_cols(pbbm, block, j, j + offset);
-               swap_cols(rhs[block], 0, j, j + offset);
-           }
+           for (i = 0; i < pbbm->nrows; i++)
+               pbbm->rows[i][block] = apply_column_map(&maps[0], pbbm->rows[i][block]);
+           //(I | 0) in pivot rows, pivots are in MSB part
+           offset = pbbm->blocksizes[block] - pbbm->pivots[block];
+           for (pivot = 0; pivot < pbbm->pivots[block]; pivot++)
+               pbbm->rows[oldrank+pivot][block] &= ~BLOCK_MASK(offset);
        }
+       if (maps[1].nbytes > 0)
+           for (k = 0; k < rhs[block]->nrows; k++)
+               rhs[block]->rows[k][0] = apply_column_map(&maps[1], rhs[block]->rows[k][0]);
 
-                
-       oldrank = rank;
-       
-       block++;
+       oldrank += pbbm->pivots[block];
      }
+     free(maps);
+     free(pivcols);
     
      return rank;
 }
@@ -308,27 +512,385 @@ int multiply_add(_block out[], _block coeff, _bbm *pbbm, int offset)
 }
 
 
+//width of table chunks for count coefficients of pivots bits (row xors of tables and lookups),
+// 0: direct sums of pivot rows are cheaper
+static int table_width(int pivots, int count)
+{
+    int w, best = 0;
+    double cost, bestcost = (double) count * pivots / 2;   //half of pivot rows on average
+
+    for (w = 1; w <= SM_TABLE_BITS && w <= pivots; w++)
+    {
+        cost = (double) ((pivots + w - 1) / w) * ((1 << w) + count);
+        if (cost < bestcost)
+        {
+            bestcost = cost;
+            best = w;
+        }
+    }
+    return best;
+}
+
+//tables of pivot rows from offset in u layout (rows of stride blocks, Method of Four Russians):
+// table c, row v = xor of pivot rows offset + c*w + bits of v (one row xor per row of the table)
+static void pivot_tables(_block *table, int stride, int w, int nchunks, _bbm *pbbm, int offset, int pivots)
+{
+    int c, b, v;
+
+    for (c = 0; c < nchunks; c++)
+        for (v = 1; v < (1 << w); v++)
+        {
+            if ((v & (v - 1)) == 0)
+            {
+                for (b = 0; (v >> b) != 1; b++)
+                    ;
+                if (c * w + b < pivots)
+                    multiply_add(table + (size_t) ((c << w) + v) * stride, ONE, pbbm, offset + c * w + b);
+            }
+            else
+            {
+                memcpy(table + (size_t) ((c << w) + v) * stride, table + (size_t) ((c << w) + (v & (v - 1))) * stride,
+                       stride * sizeof(_block));
+                add_wrow(table + (size_t) ((c << w) + v) * stride, table + (size_t) ((c << w) + (v & -v)) * stride, stride);
+            }
+        }
+}
+
+//s_i * M of each entry (rows of stride blocks), coefficients are the pivot parts (value >> r),
+// pivot rows from offset are combined into tables of w bits (see pivot_tables), then
+// each row takes one lookup per chunk of its coefficient
+static void multiply_entries(_block *rows, int stride, TableEntry *entries, int count, int r, _bbm *pbbm,
+                             int offset, int pivots)
+{
+    int i, c, v, nchunks, w = table_width(pivots, count);
+    _block y, *table;
+
+    if (w == 0)
+    {
+        for (i = 0; i < count; i++)
+            if (entries[i].value != 0)
+                multiply_add(rows + (size_t) i * stride, entries[i].value >> r, pbbm, offset);
+        return;
+    }
+
+    nchunks = (pivots + w - 1) / w;
+    table = (_block*) calloc_aligned((size_t) (nchunks << w) * stride, sizeof(_block));
+    pivot_tables(table, stride, w, nchunks, pbbm, offset, pivots);
+
+    for (i = 0; i < count; i++)
+        for (y = entries[i].value >> r, c = 0; y != 0; y >>= w, c++)
+            if ((v = (int) (y & ((ONE << w) - 1))) != 0)
+                add_wrow(rows + (size_t) i * stride, table + (size_t) ((c << w) + v) * stride, stride);
+    free_aligned(table);
+}
+
+//RHS rows by value, equal values in row order
+typedef struct {
+    _block value;
+    int    row;
+} RowKey;
+
+static int compare_rowkeys(const void *a, const void *b)
+{
+    const RowKey *ka = (const RowKey*) a, *kb = (const RowKey*) b;
+
+    if (ka->value != kb->value)
+        return (ka->value > kb->value) ? 1 : -1;
+    return ka->row - kb->row;
+}
+
 //This function is used to disallow duplicate entries in LUTs
-//TODO: add compile time define to turn this off
-int contains(_block value, TableEntry *LUT){
-	TableEntry *current = LUT;
-	while(current){
-		if(value == current->value)
-			return 1;
-		current = current->next;
-	}
-	return 0;
+// dup[i] = 1 if row i of rhs is equal to an earlier row (sort of values, then unique pass)
+//define _NO_DEDUP to skip it for RHS known to be duplicate-free
+#ifndef _NO_DEDUP
+static void mark_duplicates(_bbm *rhs, char *dup)
+{
+    int i;
+    RowKey *keys = (RowKey*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(RowKey));
+
+    for (i = 0; i < rhs->nrows; i++)
+    {
+        keys[i].value = rhs->rows[i][0];
+        keys[i].row   = i;
+    }
+    qsort(keys, rhs->nrows, sizeof(RowKey), compare_rowkeys);
+    //first occurrence is kept, as with the former check of each bucket
+    for (i = 0; i < rhs->nrows; i++)
+        dup[keys[i].row] = (i > 0 && keys[i].value == keys[i-1].value);
+    free(keys);
+}
+#endif
+
+//stable counting sort of each bucket by weight of the RHS (0..MAXBLOCKSIZE)
+static void sort_buckets(ActiveListEntry *pale, int size)
+{
+    int hist[MAXBLOCKSIZE + 2];
+    int i, w, slot;
+    int count = pale->bucket[size];
+    TableEntry *sorted = (TableEntry*) malloc((count > 0 ? count : 1) * sizeof(TableEntry));
+
+    for (slot = 0; slot < size; slot++)
+    {
+        memset(hist, 0, sizeof(hist));
+        for (i = pale->bucket[slot]; i < pale->bucket[slot+1]; i++)
+            hist[pale->entries[i].weight + 1]++;
+        hist[0] = pale->bucket[slot];
+        for (w = 0; w <= MAXBLOCKSIZE; w++)
+            hist[w+1] += hist[w];
+        for (i = pale->bucket[slot]; i < pale->bucket[slot+1]; i++)
+            sorted[hist[pale->entries[i].weight]++] = pale->entries[i];
+    }
+    memcpy(pale->entries, sorted, count * sizeof(TableEntry));
+    free(sorted);
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+    if (*(const _block*) a == *(const _block*) b) return 0;
+    return (*(const _block*) a > *(const _block*) b) ? 1 : -1;
+}
+
+int find_bucket(const ActiveListEntry* pale, _block index)
+{
+    int lo = 0, hi = pale->nbuckets, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (pale->keys[mid] < index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < pale->nbuckets && pale->keys[lo] == index) ? lo : pale->nbuckets;
+}
+
+//dense LUT: bucket, minw and fill per index
+static int use_dense(int r, int count, size_t budget)
+{
+    double bytes = ldexp(3.0 * sizeof(int), r);
+
+    if (r >= 31)
+        return 0;
+    if (bytes <= LUT_DENSE_MIN)
+        return 1;
+    return (bytes <= (double) budget && ldexp(1.0, r) <= (double) LUT_SPARSE_RATIO * count);
+}
+
+//slots of the LUT: all indices (dense), or sorted distinct indices of the RHS (sorted LUT)
+static void prepare_keys(ActiveListEntry *pale, _bbm *rhs, int r, size_t budget)
+{
+    int rhs_i, n;
+
+    if (use_dense(r, rhs->nrows, budget))
+    {
+        pale->keys     = NULL;
+        pale->nbuckets = (int) (pale->mask + 1);
+        return;
+    }
+    pale->keys = (_block*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(_block));
+    for (rhs_i = 0; rhs_i < rhs->nrows; rhs_i++)
+        pale->keys[rhs_i] = rhs->rows[rhs_i][0] & pale->mask;
+    qsort(pale->keys, rhs->nrows, sizeof(_block), compare_keys);
+    for (n = 0, rhs_i = 0; rhs_i < rhs->nrows; rhs_i++)
+        if (n == 0 || pale->keys[n-1] != pale->keys[rhs_i])
+            pale->keys[n++] = pale->keys[rhs_i];
+    pale->nbuckets = n;
+}
+
+//index mask and position of LUT index in u, returns number of index bits r
+static int set_position(ActiveListEntry *pale, _bbm *pbbm, int block, int bitoffset)
+{
+    //index mask ... 
+    int r = pbbm->blocksizes[block] - pbbm->pivots[block];
+    pale->mask = BLOCK_MASK(r);  //if r == 0 -> 0, else r ones
+
+    //position of LUT index in u
+    pale->word     = bitoffset / MAXBLOCKSIZE;
+    pale->shift    = bitoffset % MAXBLOCKSIZE;
+    pale->straddle = (pale->shift + r > MAXBLOCKSIZE);
+    return r;
+}
+
+//LUT of one block, offset: pivots of previous blocks, bitoffset: columns of previous blocks
+//budget: max. bytes of dense LUT, larger sparse LUTs keep only non-empty buckets (see LUT_BUCKET)
+static void prepare_block(ActiveListEntry *pale, _bbm *pbbm, _bbm *prhs[], int block, int offset, int bitoffset,
+                          size_t budget)
+{
+    int rhs, r, i, count, words, last, size, slot;
+    _block index, value;
+    TableEntry *te;
+    int *fill;
+    char *dup;
+    _block *rows;
+    int blocklen = GET_BL(pbbm->ncols);  //pbbm->nblocks; //(*pbbm->blocksizes[0]/MAXBLOCKSIZE);
+    int stride = ROW_STRIDE(blocklen);
+
+    r = set_position(pale, pbbm, block, bitoffset);
+
+    //size of LUT: 2^r if dense, number of distinct indices if sorted
+    prepare_keys(pale, prhs[block], r, budget);
+    size = pale->nbuckets;
+    //bucket[size+1]: empty bucket of indices missing from sorted LUT
+    pale->bucket = (int*) calloc(size + 2, sizeof(int));
+
+    //bucket sizes, then offsets: bucket i is [bucket[i], bucket[i+1])
+    for (rhs = 0; rhs < prhs[block]->nrows; rhs++)
+        pale->bucket[LUT_BUCKET(pale, prhs[block]->rows[rhs][0] & pale->mask) + 1]++;
+    for (slot = 0; slot < size; slot++)
+        pale->bucket[slot+1] += pale->bucket[slot];
+
+    //fill buckets from the end, keeps the order of former linked lists
+    fill = (int*) malloc((size > 0 ? size : 1) * sizeof(int));
+    for (slot = 0; slot < size; slot++)
+        fill[slot] = pale->bucket[slot+1];
+    pale->entries = (TableEntry*) calloc(prhs[block]->nrows, sizeof(TableEntry));
+
+    //prevents duplicates
+    dup = (char*) calloc(prhs[block]->nrows > 0 ? prhs[block]->nrows : 1, sizeof(char));
+#ifndef _NO_DEDUP
+    mark_duplicates(prhs[block], dup);
+#endif
+            
+    for (rhs = 0; rhs < prhs[block]->nrows; rhs++)
+    {
+        if (dup[rhs])
+            continue;
+
+        value = prhs[block]->rows[rhs][0];
+        index = value & (pale->mask);
+        value ^= index;                       //remove lower part
+        slot  = LUT_BUCKET(pale, index);
+
+        //TODO: allow more flexibility, including some sort order in LUT 
+        te = &pale->entries[--fill[slot]];
+        te->value  = value;
+        te->weight = prhs[block]->weights[rhs];
+    }
+
+    //remove gaps left by duplicates
+    count = 0;
+    for (slot = 0; slot < size; slot++)
+    {
+        i = fill[slot];
+        pale->bucket[slot] = count;
+        for ( ; i < pale->bucket[slot+1]; i++)
+            pale->entries[count++] = pale->entries[i];
+    }
+    pale->bucket[size] = count;
+    pale->bucket[size+1] = count;
+    free(fill);
+    free(dup);
+
+    //lightest entries first: search with max_weight can drop the rest of a bucket
+    sort_buckets(pale, size);
+
+    //lower bounds of weight for search with max_weight
+    pale->minw = (int*) calloc(size + 1, sizeof(int));
+    for (slot = 0; slot < size; slot++)
+        if (pale->bucket[slot] < pale->bucket[slot+1])
+            pale->minw[slot] = pale->entries[pale->bucket[slot]].weight;
+
+    //compute s_i * M for each entry, then pack non-zero parts into the slab
+    rows  = (_block*) calloc_aligned((size_t) count * stride, sizeof(_block));
+    multiply_entries(rows, stride, pale->entries, count, r, pbbm, offset, pbbm->pivots[block]);
+    words = 0;
+    for (i = 0; i < count; i++)
+    {
+        te = &pale->entries[i];
+        if (te->value != 0)
+        {
+            for (te->first = 0; te->first < blocklen; te->first++)
+                if (rows[(size_t) i * stride + te->first] != 0)
+                    break;
+            for (last = blocklen - 1; last > te->first; last--)
+                if (rows[(size_t) i * stride + last] != 0)
+                    break;
+            te->from = te->first;
+            te->to   = last + 1;
+            if (stride >= XOR_VECTOR)
+            {
+                //vector rows: whole aligned chunks, stays within stride (multiple of XOR_VECTOR)
+                te->from = te->from / XOR_VECTOR * XOR_VECTOR;
+                te->to   = (te->to + XOR_VECTOR - 1) / XOR_VECTOR * XOR_VECTOR;
+            }
+            words += te->to - te->from;
+        }
+        else
+        {
+            //empty row: u is forwarded
+            te->first = te->from = te->to = blocklen;
+        }
+    }
+
+    pale->slab = (_block*) calloc_aligned(words > 0 ? words : 1, sizeof(_block));
+    words = 0;
+    for (i = 0; i < count; i++)
+    {
+        te = &pale->entries[i];
+        if (te->value != 0)
+        {
+            te->sm_row = pale->slab + words;
+            memcpy(te->sm_row, rows + (size_t) i * stride + te->from, (te->to - te->from) * sizeof(_block));
+            words += te->to - te->from;
+        }
+        else
+        {
+        	te->sm_row = NULL;
+			}
+    }
+    free_aligned(rows);
+
+    //lightest entry of the block, for rest of previous blocks
+    pale->lightest = -1;
+    for (i = 0; i < count; i++)
+        if (pale->lightest < 0 || pale->entries[i].weight < pale->lightest)
+            pale->lightest = pale->entries[i].weight;
+}
+
+//suffix sums of block minima: weight that following blocks add at least
+static void set_rest(ActiveListEntry *pList, int nblocks)
+{
+    int block;
+
+    pList[nblocks - 1].rest = 0;
+    for (block = nblocks - 1; block > 0; block--)
+        pList[block-1].rest = pList[block].rest + (pList[block].lightest < 0 ? 0 : pList[block].lightest);
+}
+
+//free LUT of one block (shared LUT: only the part of the block)
+static void free_ale(ActiveListEntry *pale)
+{
+    if (pale->shared == NULL)
+    {
+        free(pale->bucket);
+        free(pale->keys);
+        free(pale->entries);
+    }
+    free(pale->minw);
+    free(pale->refs);
+    free_aligned(pale->slab);
+    free(pale->x_slab);
+    pale->refs    = NULL;
+    pale->bucket  = NULL;
+    pale->minw    = NULL;
+    pale->keys    = NULL;
+    pale->entries = NULL;
+    pale->slab    = NULL;
+    pale->x_slab  = NULL;
 }
 
 //PRE: pbbm and prhs prepared by echelonize
 //TODO?: variable block sizes - this should already work 
 //WORKAROUND: allows variable number of rhs by removing duplicate entries
-ActiveListEntry* prepare(_bbm *pbbm, _bbm *prhs[])
+//LUT of each block is a packed arena: bucket offsets, entries grouped by index,
+// one aligned slab with sm_rows trimmed to non-zero words
+// (vector rows: trimmed to aligned chunks of XOR_VECTOR words)
+//blocks with many free columns and few RHS get a sorted LUT instead of 2^r buckets
+ActiveListEntry* prepare(_bbm *pbbm, _bbm *prhs[], size_t budget)
 {
-    int block, rhs, offset, k, r;
-    _block size, index, value;
+    int block, offset, bitoffset;
     ActiveListEntry *pList;
-    int blocklen = GET_BL(pbbm->ncols);  //pbbm->nblocks; //(*pbbm->blocksizes[0]/MAXBLOCKSIZE);
     
     //PRE: pbbm has echelon form, with (I|0) in blocks with free pivots
     //      pivots are stored from LSB bits
@@ -340,250 +902,792 @@ ActiveListEntry* prepare(_bbm *pbbm, _bbm *prhs[])
       
     // this part precomputes list's lookup tables 
     //   along with S * M 
-    offset = 0; k = 0;
+    offset = 0;
+    bitoffset = 0;
     for (block = 0; block < pbbm->nblocks; block++)
     {
-    //TODO: beware, dangerous alloc! can reach 2^blocksize
-        //index mask ... 
-        r = pbbm->blocksizes[block] - pbbm->pivots[block];
-        size = ONE << r;     //size of LUT
-        pList[block].mask = (size - 1);  //if r == 0 -> 0, else r ones
-        pList[block].LUT = (TableEntry**) calloc(size, sizeof(TableEntry*));
-        //pList[block].next = NULL;    //calloc...
-        //pList[block].sol_ix = 0;
-                
-        for (rhs = 0; rhs < prhs[block]->nrows; rhs++)
+        prepare_block(&pList[block], pbbm, prhs, block, offset, bitoffset, budget);
+        offset += pbbm->pivots[block];
+        bitoffset += pbbm->blocksizes[block];
+    }
+    set_rest(pList, pbbm->nblocks);
+    
+    return pList;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Shared LUTs
+
+//candidates of the canonical translate (see canonical_rhs)
+#define SHARE_MAX_TRIES 64
+
+//interned LUT: bucket offsets, keys and values of entries (order, weights, sm_rows and x_rows are per block)
+typedef struct {
+    ActiveListEntry lut;
+    int     count;          //distinct RHS values
+    _block *values;         //canonical translate of the RHS set, sorted
+    unsigned long long hash;
+} SharedTable;
+
+struct SharedLUTs {
+    SharedTable *tables;
+    int count;
+};
+
+static int compare_sets(const _block *a, const _block *b, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (a[i] != b[i])
+            return (a[i] > b[i]) ? 1 : -1;
+    return 0;
+}
+
+//canonical translate of set S of n sorted distinct values: smallest sorted S ^ t of t in S, stored
+// to canon, returns t (S = canon ^ t), tmp: n values
+//second value of S ^ t is min. s ^ t, so only t of closest pairs can give the smallest set,
+// closest pairs are adjacent in sorted order (tries are limited, sharing may be missed then)
+static _block canonical_rhs(const _block *values, int n, _block *canon, _block *tmp)
+{
+    int i, j, tries = 0;
+    _block dmin, best = 0;
+
+    if (n == 0)
+        return 0;
+    dmin = (n > 1) ? values[1] ^ values[0] : 0;
+    for (i = 2; i < n; i++)
+        if ((values[i] ^ values[i-1]) < dmin)
+            dmin = values[i] ^ values[i-1];
+
+    for (i = 0; i < n && tries < SHARE_MAX_TRIES; i++)
+    {
+        if (n > 1 && !(i > 0 && (values[i] ^ values[i-1]) == dmin) && !(i + 1 < n && (values[i] ^ values[i+1]) == dmin))
+            continue;
+        for (j = 0; j < n; j++)
+            tmp[j] = values[j] ^ values[i];
+        qsort(tmp, n, sizeof(_block), compare_keys);
+        if (tries++ == 0 || compare_sets(tmp, canon, n) < 0)
         {
-            value = prhs[block]->rows[rhs][0];
-            index = value & (pList[block].mask);
-            value ^= index;                       //remove lower part
-            
-            //check whether the value is in the lut list
-            //prevents duplicates
-            if(contains(value, pList[block].LUT[index]) == 1)
-		continue;
+            memcpy(canon, tmp, n * sizeof(_block));
+            best = values[i];
+        }
+    }
+    return best;
+}
 
-            //TODO: allow more flexibility, including some sort order in LUT 
-            
-            //create new entry in linked list
-            TableEntry* nte = (TableEntry*) calloc(1, sizeof(TableEntry));
-            nte->value = value;
-            nte->weight = prhs[block]->weights[rhs];
-            nte->next = pList[block].LUT[index];
-            pList[block].LUT[index] = nte;           
-            
-            if (value != 0)
+//LUT of a canonical set: slots as in prepare_keys, entries of a bucket in the order of values
+static void build_shared_table(SharedTable *st, size_t budget)
+{
+    ActiveListEntry *lut = &st->lut;
+    int i, n, slot, r = 0;
+    int *fill;
+
+    while (r < MAXBLOCKSIZE && (lut->mask >> r) != 0)
+        r++;
+    if (use_dense(r, st->count, budget))
+    {
+        lut->keys     = NULL;
+        lut->nbuckets = (int) (lut->mask + 1);
+    }
+    else
+    {
+        lut->keys = (_block*) malloc((st->count > 0 ? st->count : 1) * sizeof(_block));
+        for (i = 0; i < st->count; i++)
+            lut->keys[i] = st->values[i] & lut->mask;
+        qsort(lut->keys, st->count, sizeof(_block), compare_keys);
+        for (n = 0, i = 0; i < st->count; i++)
+            if (n == 0 || lut->keys[n-1] != lut->keys[i])
+                lut->keys[n++] = lut->keys[i];
+        lut->nbuckets = n;
+    }
+
+    lut->bucket = (int*) calloc(lut->nbuckets + 2, sizeof(int));
+    for (i = 0; i < st->count; i++)
+        lut->bucket[LUT_BUCKET(lut, st->values[i] & lut->mask) + 1]++;
+    for (slot = 0; slot < lut->nbuckets; slot++)
+        lut->bucket[slot+1] += lut->bucket[slot];
+    lut->bucket[lut->nbuckets+1] = st->count;
+
+    fill = (int*) malloc((lut->nbuckets + 1) * sizeof(int));
+    memcpy(fill, lut->bucket, (lut->nbuckets + 1) * sizeof(int));
+    lut->entries = (TableEntry*) calloc(st->count > 0 ? st->count : 1, sizeof(TableEntry));
+    for (i = 0; i < st->count; i++)
+        lut->entries[fill[LUT_BUCKET(lut, st->values[i] & lut->mask)]++].value = st->values[i] & ~lut->mask;
+    free(fill);
+}
+
+//interned LUT of the canonical set (n values), canon is taken over or freed
+static SharedTable* intern_table(SharedLUTs *shared, _block mask, _block *canon, int n, size_t budget)
+{
+    unsigned long long hash = 0xcbf29ce484222325ull;
+    SharedTable *st;
+    int i;
+
+    for (i = 0; i < n; i++)
+        hash = (hash ^ canon[i]) * 0x100000001b3ull;
+    for (i = 0; i < shared->count; i++)
+    {
+        st = &shared->tables[i];
+        if (st->lut.mask == mask && st->count == n && st->hash == hash && compare_sets(st->values, canon, n) == 0)
+        {
+            free(canon);
+            return st;
+        }
+    }
+
+    st = &shared->tables[shared->count++];
+    st->lut.mask = mask;
+    st->count    = n;
+    st->values   = canon;
+    st->hash     = hash;
+    build_shared_table(st, budget);
+    return st;
+}
+
+//entry of a bucket in a block, order of prepare_block: lightest first, then the last RHS row first
+typedef struct {
+    EntryRef ref;
+    int      row;
+} RefKey;
+
+static int compare_refkeys(const void *a, const void *b)
+{
+    const RefKey *ka = (const RefKey*) a, *kb = (const RefKey*) b;
+
+    if (ka->ref.weight != kb->ref.weight)
+        return ka->ref.weight - kb->ref.weight;
+    return kb->row - ka->row;
+}
+
+//block with interned LUT: translation, entries of buckets with weights, min. weights, tables of pivot rows
+static void prepare_shared_block(ActiveListEntry *pale, SharedLUTs *shared, _bbm *pbbm, _bbm *prhs[], int block,
+                                 int offset, int bitoffset, size_t budget)
+{
+    _bbm *rhs = prhs[block];
+    int i, n, lo, hi, mid, slot, c, v, last, width;
+    int *rows;
+    int blocklen = GET_BL(pbbm->ncols);
+    int stride = ROW_STRIDE(blocklen);
+    int pivots = pbbm->pivots[block];
+    int r = set_position(pale, pbbm, block, bitoffset);
+    RowKey *keys = (RowKey*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(RowKey));
+    RefKey *refs = (RefKey*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(RefKey));
+    _block *values = (_block*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(_block));
+    _block *canon = (_block*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(_block));
+    _block *tmp = (_block*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(_block));
+    _block t, index, *table;
+    SharedTable *st;
+
+    //distinct values of the RHS set, first row of each (duplicates are dropped as in prepare_block)
+    for (i = 0; i < rhs->nrows; i++)
+    {
+        keys[i].value = rhs->rows[i][0];
+        keys[i].row   = i;
+    }
+    qsort(keys, rhs->nrows, sizeof(RowKey), compare_rowkeys);
+    rows = (int*) malloc((rhs->nrows > 0 ? rhs->nrows : 1) * sizeof(int));
+    for (n = 0, i = 0; i < rhs->nrows; i++)
+        if (n == 0 || keys[i].value != values[n-1])
+        {
+            values[n] = keys[i].value;
+            rows[n++] = keys[i].row;
+        }
+
+    t  = canonical_rhs(values, n, canon, tmp);
+    st = intern_table(shared, pale->mask, canon, n, budget);
+    pale->shared   = shared;
+    pale->bucket   = st->lut.bucket;
+    pale->keys     = st->lut.keys;
+    pale->nbuckets = st->lut.nbuckets;
+    pale->entries  = st->lut.entries;
+    pale->xidx     = t & pale->mask;
+    pale->xval     = t & ~pale->mask;
+
+    //row of each entry in this block: value of the block from LUT slot and entry
+    for (slot = 0; slot < pale->nbuckets; slot++)
+    {
+        index = (pale->keys == NULL) ? (_block) slot : pale->keys[slot];
+        for (i = pale->bucket[slot]; i < pale->bucket[slot+1]; i++)
+        {
+            for (lo = 0, hi = n - 1; lo < hi; )
             {
-                //zero-out corresponding rows of S*M
-                //memset(psm->rows[k], 0, sizeof(_block)*prhs->nblocks);
-            	nte->sm_row = (_block*) calloc(blocklen, sizeof(_block));
-                //if there are free pivots, compute corresponding s_i * M
-                nte->first = multiply_add(nte->sm_row, 
-                                  (value)>>r, //move it back
-                                  pbbm, offset);
-                                  
-                k++;
+                mid = lo + (hi - lo) / 2;
+                if (values[mid] < (pale->entries[i].value ^ t ^ index))
+                    lo = mid + 1;
+                else
+                    hi = mid;
             }
-            else
-            {
-            	nte->sm_row = NULL;
-			}
+            refs[i].ref.entry  = i;
+            refs[i].ref.weight = rhs->weights[rows[lo]];
+            refs[i].row        = rows[lo];
         }
+        qsort(refs + pale->bucket[slot], pale->bucket[slot+1] - pale->bucket[slot], sizeof(RefKey), compare_refkeys);
+    }
+
+    pale->refs = (EntryRef*) malloc((n > 0 ? n : 1) * sizeof(EntryRef));
+    pale->minw = (int*) calloc(pale->nbuckets + 1, sizeof(int));
+    pale->lightest = -1;
+    for (i = 0; i < n; i++)
+    {
+        pale->refs[i] = refs[i].ref;
+        if (pale->lightest < 0 || refs[i].ref.weight < pale->lightest)
+            pale->lightest = refs[i].ref.weight;
+    }
+    for (slot = 0; slot < pale->nbuckets; slot++)
+        if (pale->bucket[slot] < pale->bucket[slot+1])
+            pale->minw[slot] = pale->refs[pale->bucket[slot]].weight;
+    free(keys);
+    free(refs);
+    free(rows);
+    free(values);
+    free(tmp);
+
+    //tables of pivot rows, rows trimmed to the words where any of them is non-zero
+    pale->yshift = r;
+    pale->tables = (pivots + SHARE_TABLE_BITS - 1) / SHARE_TABLE_BITS;
+    table = (_block*) calloc_aligned((size_t) (pale->tables << SHARE_TABLE_BITS) * stride + 1, sizeof(_block));
+    pivot_tables(table, stride, SHARE_TABLE_BITS, pale->tables, pbbm, offset, pivots);
+    pale->first = blocklen;
+    last = -1;
+    for (i = 0; i < (pale->tables << SHARE_TABLE_BITS); i++)
+        for (c = 0; c < blocklen; c++)
+            if (table[(size_t) i * stride + c] != 0)
+            {
+                if (c < pale->first)
+                    pale->first = c;
+                if (c > last)
+                    last = c;
+            }
+    pale->from = pale->first;
+    pale->to   = (last < pale->first) ? blocklen : last + 1;
+    if (stride >= XOR_VECTOR && pale->from < pale->to)
+    {
+        pale->from = pale->from / XOR_VECTOR * XOR_VECTOR;
+        pale->to   = (pale->to + XOR_VECTOR - 1) / XOR_VECTOR * XOR_VECTOR;
+    }
+    width = pale->to - pale->from;
+    pale->slab = (_block*) calloc_aligned((size_t) (pale->tables << SHARE_TABLE_BITS) * width + 1, sizeof(_block));
+    for (c = 0; c < pale->tables; c++)
+        for (v = 0; v < (1 << SHARE_TABLE_BITS); v++)
+            memcpy(pale->slab + (size_t) ((c << SHARE_TABLE_BITS) + v) * width,
+                   table + (size_t) ((c << SHARE_TABLE_BITS) + v) * stride + pale->from, width * sizeof(_block));
+    free_aligned(table);
+}
+
+/// as prepare, blocks with the same RHS set up to translation share one LUT
+ActiveListEntry* prepare_shared(_bbm *pbbm, _bbm *prhs[], size_t budget)
+{
+    int block, offset = 0, bitoffset = 0;
+    ActiveListEntry *pList = (ActiveListEntry*) calloc(pbbm->nblocks, sizeof(ActiveListEntry));
+    SharedLUTs *shared = (SharedLUTs*) calloc(1, sizeof(SharedLUTs));
+
+    shared->tables = (SharedTable*) calloc(pbbm->nblocks, sizeof(SharedTable));
+    for (block = 0; block < pbbm->nblocks; block++)
+    {
+        prepare_shared_block(&pList[block], shared, pbbm, prhs, block, offset, bitoffset, budget);
         offset += pbbm->pivots[block];
+        bitoffset += pbbm->blocksizes[block];
     }
-    
+    set_rest(pList, pbbm->nblocks);
     return pList;
 }
 
+/// number of interned LUTs of the list (0: LUTs of blocks are not shared)
+int shared_luts(ActiveListEntry* ale)
+{
+    return (ale[0].shared != NULL) ? ale[0].shared->count : 0;
+}
+
+/// u ^= s_i * M of entry i of the block (stored part of the row), u: ROW_STRIDE(blocklen) words
+void add_entry_row(ActiveListEntry* pale, int i, _block *u)
+{
+    int b, c, width;
+    const _block *row;
+    _block y;
+
+    if (pale->shared == NULL)
+    {
+        if (pale->entries[i].value != 0)
+            for (b = pale->entries[i].from; b < pale->entries[i].to; b++)
+                u[b] ^= pale->entries[i].sm_row[b - pale->entries[i].from];
+        return;
+    }
+    width = pale->to - pale->from;
+    for (y = ENTRY_VALUE(pale, i) >> pale->yshift, c = 0; y != 0; y >>= SHARE_TABLE_BITS, c++)
+    {
+        row = pale->slab + (size_t) ((c << SHARE_TABLE_BITS) + (int) (y & ((ONE << SHARE_TABLE_BITS) - 1))) * width;
+        for (b = pale->from; b < pale->to; b++)
+            u[b] ^= row[b - pale->from];
+    }
+}
+
+//deferred LUTs of prepare_lazy, shared by all copies of the list (workers of parallel search)
+struct LazyLUTs {
+    ActiveListEntry *ale;       //list from prepare_lazy, LUTs are built here
+    _bbm   *pbbm, **prhs, *pA;
+    size_t  budget;
+    int    *offset, *bitoffset; //pivots and columns of previous blocks
+#ifdef _OPENMP
+    omp_lock_t lock;            //one block is built at a time
+#endif
+};
+
 void free_ales(ActiveListEntry* ale, int count)
 {
      int i;
-     _block j;
-     TableEntry* next, *nextnext;
+     LazyLUTs *lazy = (count > 0) ? ale[0].lazy : NULL;
+     SharedLUTs *shared = (count > 0) ? ale[0].shared : NULL;
+
      for (i = 0; i < count; i++)
+         free_ale(&ale[i]);
+     free(ale);
+     if (shared != NULL)
      {
-         for (j = 0; j <= ale[i].mask; j++)
+         for (i = 0; i < shared->count; i++)
          {
-             next = ale[i].LUT[j];
-             while (next != NULL)
-             {
-                   nextnext = next->next;
-                   if (next->sm_row != NULL)
-                		free(next->sm_row);
-                   free(next);
-                   next = nextnext;
-             }
+             free(shared->tables[i].lut.bucket);
+             free(shared->tables[i].lut.keys);
+             free(shared->tables[i].lut.entries);
+             free(shared->tables[i].values);
          }
-         free(ale[i].LUT);
+         free(shared->tables);
+         free(shared);
+     }
+     if (lazy != NULL)
+     {
+#ifdef _OPENMP
+         omp_destroy_lock(&lazy->lock);
+#endif
+         free(lazy->offset);
+         free(lazy->bitoffset);
+         free(lazy);
      }
-     free(ale);
 }
 
+//x_rows of one block, offset: pivots of previous blocks
+static void prepare_x_block(ActiveListEntry *pale, _bbm *pbbm, _bbm *pA, int block, int offset)
+{
+    int i, j, w, count;
+    int words = GET_NUM_BLOCKS(pbbm->nrows);
+    int r = pbbm->blocksizes[block] - pbbm->pivots[block];
+    _block y;
+    TableEntry *te;
 
+    //shared LUT: pivot rows of A of the block, get_solution_x multiplies
+    if (pale->shared != NULL)
+    {
+        pale->x_slab = (_block*) calloc((size_t) (pbbm->pivots[block] > 0 ? pbbm->pivots[block] : 1) * words, sizeof(_block));
+        for (j = 0; j < pbbm->pivots[block]; j++)
+            memcpy(pale->x_slab + (size_t) j * words, pA->rows[offset + j], words * sizeof(_block));
+        return;
+    }
 
+    count = pale->bucket[pale->nbuckets];
+    pale->x_slab = (_block*) calloc((size_t) (count > 0 ? count : 1) * words, sizeof(_block));
 
-//TODO: variable block sizes, variable number of rhs
-long long int solve_it(ActiveListEntry* ale, _bbm *pbbm, int block, 
-                       _block* sol_stack, long long int *pCount, long long int *pXors, int max_weight, int abort,
-                        sol_rep_fn_t report_solution)
+    for (i = 0; i < count; i++)
+    {
+        te = &pale->entries[i];
+        te->x_row = pale->x_slab + (size_t) i * words;
+        //y of the block: pivot part of the value, as in val >> r
+        y = te->value >> r;
+        for (j = 0; y != 0; j++, y >>= 1)
+            if (y & ONE)
+                for (w = 0; w < words; w++)
+                    te->x_row[w] ^= pA->rows[offset + j][w];
+    }
+}
+
+/// solution x of each entry: y-part of the entry (pivot bits) times rows of A
+//PRE: pA from echelonize of the same pbbm, ale from prepare
+void prepare_x(ActiveListEntry* ale, _bbm *pbbm, _bbm *pA)
 {
-    long long int count = 0;
-    long long int xors = 0;
-    long long int total = 0;
-    int b;
-    _block index;
-    TableEntry * active;
-    _block *nr, *or, *ar, value;  //new row, old row, active row, value from u
-    int blocklen = GET_BL(pbbm->ncols);  //pbbm->nblocks; //(*pbbm->blocksizes[0]/MAXBLOCKSIZE);
-    //int blocksize = pbbm->blocksizes[0];  //TODO: variable block sizes...
-    int bitoffset;
-    int bits_count = 0;
+    int block, offset = 0;
+
+    for (block = 0; block < pbbm->nblocks; block++)
+    {
+        prepare_x_block(&ale[block], pbbm, pA, block, offset);
+        offset += pbbm->pivots[block];
+    }
+}
 
-    int weight = 0, *weights = calloc(pbbm->nblocks, sizeof(int));
+/// rebuilds LUTs of nchanged blocks (indices in blocks) from prhs, other blocks are kept
+/// pA != NULL: x_rows of rebuilt blocks too (see prepare_x), budget as in prepare
+//PRE: ale from prepare of the same pbbm, prhs of the changed blocks transformed as by echelonize
+void update_ales(ActiveListEntry* ale, _bbm *pbbm, _bbm *prhs[], _bbm *pA, const int *blocks, int nchanged, size_t budget)
+{
+    int i, block, offset, bitoffset;
 
-    nr = or = sol_stack;
-    //max_weight = 5;
-    
-    //ASSERT: block == 1, sol->pivots == 0 for each block
-    bitoffset = 0;
-    while (block >= 0)
+    for (i = 0; i < nchanged; i++)
     {
-        active = ale[block].next;
+        offset = 0;
+        bitoffset = 0;
+        for (block = 0; block < blocks[i]; block++)
+        {
+            offset += pbbm->pivots[block];
+            bitoffset += pbbm->blocksizes[block];
+        }
+        block = blocks[i];
+        free_ale(&ale[block]);
+        prepare_block(&ale[block], pbbm, prhs, block, offset, bitoffset, budget);
+        if (pA != NULL)
+            prepare_x_block(&ale[block], pbbm, pA, block, offset);
+    }
+    set_rest(ale, pbbm->nblocks);
+}
+
+/// as prepare and prepare_x (pA != NULL), LUT of each block is built when the search reaches it,
+/// only the LUT of the first block is built at once
+//PRE: pbbm, prhs and pA are kept until free_ales, no checkpoints (they hash all LUTs)
+ActiveListEntry* prepare_lazy(_bbm *pbbm, _bbm *prhs[], _bbm *pA, size_t budget)
+{
+    int block, rhs;
+    ActiveListEntry *pList = (ActiveListEntry*) calloc(pbbm->nblocks, sizeof(ActiveListEntry));
+    LazyLUTs *lazy = (LazyLUTs*) calloc(1, sizeof(LazyLUTs));
 
-        //no more to process
-        if (active == NULL  || weight > max_weight)
+    lazy->ale    = pList;
+    lazy->pbbm   = pbbm;
+    lazy->prhs   = prhs;
+    lazy->pA     = pA;
+    lazy->budget = budget;
+    lazy->offset    = (int*) calloc(pbbm->nblocks, sizeof(int));
+    lazy->bitoffset = (int*) calloc(pbbm->nblocks, sizeof(int));
+#ifdef _OPENMP
+    omp_init_lock(&lazy->lock);
+#endif
+
+    for (block = 0; block < pbbm->nblocks; block++)
+    {
+        if (block > 0)
         {
-            //backtrack
-            block--;
-            weight -= weights[block];
+            lazy->offset[block]    = lazy->offset[block-1] + pbbm->pivots[block-1];
+            lazy->bitoffset[block] = lazy->bitoffset[block-1] + pbbm->blocksizes[block-1];
+        }
+        set_position(&pList[block], pbbm, block, lazy->bitoffset[block]);
+        pList[block].lazy = lazy;
 
-            //TODO: possible optimalization: allocate one block before blocksizes to allow negative index
-            if (block >= 0)
-                bitoffset -= pbbm->blocksizes[block];
+        //lightest RHS of the block, duplicates have the same weight
+        pList[block].lightest = -1;
+        for (rhs = 0; rhs < prhs[block]->nrows; rhs++)
+            if (pList[block].lightest < 0 || prhs[block]->weights[rhs] < pList[block].lightest)
+                pList[block].lightest = prhs[block]->weights[rhs];
+    }
+    set_rest(pList, pbbm->nblocks);
+
+    //root of the search
+    load_lut(pList, 0);
+    return pList;
+}
+
+//LUT of one block: tables only, cursors of the search are not touched
+static void copy_lut(ActiveListEntry *pdst, const ActiveListEntry *psrc)
+{
+    pdst->bucket   = psrc->bucket;
+    pdst->keys     = psrc->keys;
+    pdst->nbuckets = psrc->nbuckets;
+    pdst->minw     = psrc->minw;
+    pdst->entries  = psrc->entries;
+    pdst->slab     = psrc->slab;
+    pdst->x_slab   = psrc->x_slab;
+}
+
+/// builds LUT of ale[block] on the first visit (prepare_lazy), copies of the list get the shared LUT
+void load_lut(ActiveListEntry* ale, int block)
+{
+    LazyLUTs *lazy = ale[block].lazy;
+    ActiveListEntry *pbuilt = &lazy->ale[block];
+    ActiveListEntry local;
+
+#ifdef _OPENMP
+    omp_set_lock(&lazy->lock);
+#endif
+    if (pbuilt->bucket == NULL)
+    {
+        //built aside, the list can be the active list of the caller
+        local = *pbuilt;
+        prepare_block(&local, lazy->pbbm, lazy->prhs, block, lazy->offset[block], lazy->bitoffset[block], lazy->budget);
+        if (lazy->pA != NULL)
+            prepare_x_block(&local, lazy->pbbm, lazy->pA, block, lazy->offset[block]);
+        copy_lut(pbuilt, &local);
+    }
+    if (pbuilt != &ale[block])
+        copy_lut(&ale[block], pbuilt);
+#ifdef _OPENMP
+    omp_unset_lock(&lazy->lock);
+#endif
+}
+
+/// expected number of entries per LUT index of block (RHS of the block if LUT is not built yet)
+double lut_density(ActiveListEntry* ale, int block)
+{
+    int count = (ale[block].bucket != NULL) ? ale[block].bucket[ale[block].nbuckets]
+                                            : ale[block].lazy->prhs[block]->nrows;
+    return count / ((double) ale[block].mask + 1);
+}
+
+/// solution x = xor of x_rows of entries on the path (ale[b].next-1 of each block)
+/// x: GET_NUM_BLOCKS(pbbm->nrows) words
+//PRE: prepare_x, called from report_solution
+void get_solution_x(ActiveListEntry* ale, _bbm *pbbm, _block *x)
+{
+    int block, w, j;
+    int words = GET_NUM_BLOCKS(pbbm->nrows);
+    _block *row, y;
+
+    memset(x, 0, words * sizeof(_block));
+    for (block = 0; block < pbbm->nblocks; block++)
+    {
+        if (ale[block].shared != NULL)
+        {
+            y = ENTRY_VALUE(&ale[block], ale[block].next - 1) >> ale[block].yshift;
+            for (j = 0; y != 0; j++, y >>= 1)
+                if (y & ONE)
+                    for (w = 0, row = ale[block].x_slab + (size_t) j * words; w < words; w++)
+                        x[w] ^= row[w];
             continue;
         }
-        weight += active->weight;
-        weights[block] = active->weight;
+        row = ale[block].entries[ale[block].next - 1].x_row;
+        for (w = 0; w < words; w++)
+            x[w] ^= row[w];
+    }
+}
 
 
-        //reporting
-        ++total;
 
-        //prepare stack for next solution
-        ale[block].next = active->next;
 
-        //are we at the end?
-        if (block == pbbm->nblocks - 1)
-        {
-            if (weight > max_weight)
-             {
-                 weight -= active->weight;
+/// calls all chained monitors, returns non-zero if any of them stops the search
+int call_monitors(SearchMonitor *monitor, ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                  long long int count, long long int total, long long int xors)
+{
+    int stop = 0;
+    for ( ; monitor != NULL; monitor = monitor->next)
+        stop |= monitor->fn(monitor, ale, pbbm, block, weight, count, total, xors);
+    return stop;
+}
 
-                 continue;
-             }
-             //solution found    
-            ++count;
+//specialized search kernels, see mrhs.rz.kernel.h
+typedef long long int (*solve_kernel_t)(ActiveListEntry* ale, _bbm *pbbm, int root, int block, int weight,
+                       _block* sol_stack, long long int *pCount, long long int *pXors, int max_weight, int abort,
+                       sol_rep_fn_t report_solution, void *report_data, SearchPool *pool, SearchMonitor *monitor);
 
-            //recompute solution - finalne prepocitanie 
-            ale[block].val = (ale[block].val & ale[block].mask) ^ active->value;
+#define KERNEL_NAME solve_it_bl1
+#define KERNEL_BL 1
+#define KERNEL_ALIGNED 1
+#include "mrhs.rz.kernel.h"
 
-            if (report_solution != NULL)
-                if (!report_solution(count, pbbm, ale, weight) && abort == 1)
-					break;
+#define KERNEL_NAME solve_it_bl2
+#define KERNEL_BL 2
+#include "mrhs.rz.kernel.h"
 
-            weight -= active->weight;
+#define KERNEL_NAME solve_it_bl2_aligned
+#define KERNEL_BL 2
+#define KERNEL_ALIGNED 1
+#include "mrhs.rz.kernel.h"
 
-            //break;
-	    //TODO: why does it generate infinite loop...
-            continue;
-        }
+#define KERNEL_NAME solve_it_bl4
+#define KERNEL_BL 4
+#include "mrhs.rz.kernel.h"
 
-        //no change required in solution if active.value == 0, else add sm
-        if (active->value == 0)
-        {
-            // ak je v pravej strane vo volnej casi same nuly tak sa neprepocitava riesenie 
-            // u sa forwarduje
-            //recompute solution
-            ale[block].val = (ale[block].val& ale[block].mask)^active->value;
-            
-            // ale block u je akokeby stack
-            ale[block+1].u = ale[block].u;
-            nr = ale[block].u;
-        }
-        else
-        {
-            // ale block u je akokeby stack
-            or = ale[block].u;
-            nr = or+blocklen;
-            ale[block+1].u = nr;
-            
-            //add to previous solution, before "block" all zeroes
-            ar = active->sm_row;
-            
-            //or[block] = (or[block]& ale[block].mask)^active->value;
-            ale[block].val = (ale[block].val& ale[block].mask)^active->value;
-            
-            //add block to u
-            for (b = active->first; b < blocklen; b++)
-            {
-                 nr[b] = or[b]^ar[b];
-                 //reporting:
-                 xors++;
-            }
-        }
-        
-        //get LUT index
-        bitoffset += pbbm->blocksizes[block];
-        block++;
-        
-        //get bits from u...
-        //bitoffset = (block*blocksize);
-        // nr - new Row - doterajsi medzisucet - v nr je 54 bitov ale len po tu hranicu
-        // or - old Row starsi sucet - to co bolo - tu treba pocet jednotiek 
-        // vo value ake nove bity pribudli 
-        value = (nr[bitoffset/MAXBLOCKSIZE]>>(bitoffset%MAXBLOCKSIZE))^ ((nr[bitoffset/MAXBLOCKSIZE+1]<<(MAXBLOCKSIZE-1-bitoffset%MAXBLOCKSIZE))<<1);
-        index = value & ale[block].mask; // kontrolna cast rozdelenej pravej strany v tej tabulke v novom bloku
-        ale[block].next = ale[block].LUT[index]; // v loopoUp tabulke sa najdu volne vybery
+#define KERNEL_NAME solve_it_bl4_aligned
+#define KERNEL_BL 4
+#define KERNEL_ALIGNED 1
+#include "mrhs.rz.kernel.h"
 
-        //weight -= active->weight;
+#define KERNEL_NAME solve_it_bl8
+#define KERNEL_BL 8
+#include "mrhs.rz.kernel.h"
 
-    	ale[block].val = index;
+#define KERNEL_NAME solve_it_bl8_aligned
+#define KERNEL_BL 8
+#define KERNEL_ALIGNED 1
+#include "mrhs.rz.kernel.h"
 
-        //gp_experiment->lookups++;
-    }
-    //all done, back to root
-    if (pCount != NULL)
-        *pCount += count;
-    if (pXors != NULL)
-        *pXors += xors;
+#define KERNEL_NAME solve_it_generic_aligned
+#define KERNEL_ALIGNED 1
+#include "mrhs.rz.kernel.h"
+
+//irregular systems
+#define KERNEL_NAME solve_it_generic
+#include "mrhs.rz.kernel.h"
+
+//plain variants: dense prepared LUTs, serial without monitor, no weight bound
+#define KERNEL_NAME solve_it_bl1_plain
+#define KERNEL_BL 1
+#define KERNEL_ALIGNED 1
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_bl2_plain
+#define KERNEL_BL 2
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_bl2_aligned_plain
+#define KERNEL_BL 2
+#define KERNEL_ALIGNED 1
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_bl4_plain
+#define KERNEL_BL 4
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_bl4_aligned_plain
+#define KERNEL_BL 4
+#define KERNEL_ALIGNED 1
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_bl8_plain
+#define KERNEL_BL 8
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_bl8_aligned_plain
+#define KERNEL_BL 8
+#define KERNEL_ALIGNED 1
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_generic_aligned_plain
+#define KERNEL_ALIGNED 1
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_generic_plain
+#define KERNEL_PLAIN 1
+#include "mrhs.rz.kernel.h"
+
+//shared LUTs (prepare_shared), any blocklen
+#define KERNEL_NAME solve_it_generic_aligned_shared
+#define KERNEL_ALIGNED 1
+#define KERNEL_SHARED 1
+#include "mrhs.rz.kernel.h"
+
+#define KERNEL_NAME solve_it_generic_shared
+#define KERNEL_SHARED 1
+#include "mrhs.rz.kernel.h"
+
+//kernels by blocklen and alignment of LUT indices, see select_kernel
+typedef struct {
+    const char *name, *plain_name;
+    solve_kernel_t kernel, plain;
+} KernelVariant;
+
+static const KernelVariant kernels[] = {
+    {"bl1",             "bl1 plain",             solve_it_bl1,             solve_it_bl1_plain},
+    {"bl2",             "bl2 plain",             solve_it_bl2,             solve_it_bl2_plain},
+    {"bl2 aligned",     "bl2 aligned plain",     solve_it_bl2_aligned,     solve_it_bl2_aligned_plain},
+    {"bl4",             "bl4 plain",             solve_it_bl4,             solve_it_bl4_plain},
+    {"bl4 aligned",     "bl4 aligned plain",     solve_it_bl4_aligned,     solve_it_bl4_aligned_plain},
+    {"bl8",             "bl8 plain",             solve_it_bl8,             solve_it_bl8_plain},
+    {"bl8 aligned",     "bl8 aligned plain",     solve_it_bl8_aligned,     solve_it_bl8_aligned_plain},
+    {"generic",         "generic plain",         solve_it_generic,         solve_it_generic_plain},
+    {"generic aligned", "generic aligned plain", solve_it_generic_aligned, solve_it_generic_aligned_plain},
+    {"generic shared",         NULL,             solve_it_generic_shared,         NULL},
+    {"generic aligned shared", NULL,             solve_it_generic_aligned_shared, NULL},
+};
+
+//kernel by blocklen and LUT index positions of prepared system (index to kernels)
+static int kernel_variant(ActiveListEntry* ale, _bbm *pbbm)
+{
+    int block, aligned = 1;
+    int blocklen = GET_BL(pbbm->ncols);
     
-    return total;
+    for (block = 0; block < pbbm->nblocks; block++)
+        if (ale[block].straddle)
+            aligned = 0;
+
+    if (ale[0].shared != NULL)
+        return aligned ? 10 : 9;
+
+    switch (blocklen)
+    {
+    case 1:
+        return 0;
+    case 2:
+        return aligned ? 2 : 1;
+    case 4:
+        return aligned ? 4 : 3;
+    case 8:
+        return aligned ? 6 : 5;
+    }
+    return aligned ? 8 : 7;
+}
+
+//plain kernel can be used: serial search without monitor, no sorted, lazy or shared LUTs,
+// no weight bound (weight of RHS is at most the blocksize, so no path is heavier than ncols)
+static int plain_search(ActiveListEntry* ale, _bbm *pbbm, int max_weight, int hooked)
+{
+    int block;
+
+    if (hooked || max_weight < pbbm->ncols)
+        return 0;
+    for (block = 0; block < pbbm->nblocks; block++)
+        if (ale[block].keys != NULL || ale[block].lazy != NULL || ale[block].shared != NULL)
+            return 0;
+    return 1;
+}
+
+static solve_kernel_t select_kernel(ActiveListEntry* ale, _bbm *pbbm, int max_weight, SearchPool *pool, SearchMonitor *monitor)
+{
+    int variant = kernel_variant(ale, pbbm);
+    return plain_search(ale, pbbm, max_weight, pool != NULL || monitor != NULL) ? kernels[variant].plain : kernels[variant].kernel;
+}
+
+/// name of the search kernel used for prepared system and max_weight, hooked: parallel search or search with a monitor
+const char* get_kernel_name(ActiveListEntry* ale, _bbm *pbbm, int max_weight, int hooked)
+{
+    int variant = kernel_variant(ale, pbbm);
+    return plain_search(ale, pbbm, max_weight, hooked) ? kernels[variant].plain_name : kernels[variant].name;
+}
+
+//TODO: variable number of rhs
+long long int solve_it(ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                       _block* sol_stack, long long int *pCount, long long int *pXors, int max_weight, int abort,
+                       sol_rep_fn_t report_solution, void *report_data, SearchPool *pool, SearchMonitor *monitor)
+{
+    return select_kernel(ale, pbbm, max_weight, pool, monitor)(ale, pbbm, block, block, weight, sol_stack, pCount, pXors, max_weight, abort,
+                                                               report_solution, report_data, pool, monitor);
+}
+
+/// continue serial search of the whole tree from restored state at depth block
+long long int solve_from(ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                         _block* sol_stack, long long int *pCount, long long int *pXors, int max_weight, int abort,
+                         sol_rep_fn_t report_solution, void *report_data, SearchMonitor *monitor)
+{
+    return select_kernel(ale, pbbm, max_weight, NULL, monitor)(ale, pbbm, 0, block, weight, sol_stack, pCount, pXors, max_weight, abort,
+                                                               report_solution, report_data, NULL, monitor);
 }
 
 //front end to non-recursive call
-//TODO: for multiprocessing, fork can be used and new process created for each rhs
-//TODO: for threading, sol must be created for each rhs/thread 
-long long int solve(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors, int weight, int abort, sol_rep_fn_t report_solution)
+//multiprocessing: independent processes search disjoint shards, see solve_parallel
+long long int solve(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors, int weight, int abort, sol_rep_fn_t report_solution, void *report_data,
+                    SearchMonitor *monitor)
 {
     long long int total = 0;
     
     //TODO: variable block size
     int blocklen = GET_BL(pbbm->ncols); //pbbm->nblocks; //(*pbbm->blocksizes[0]/MAXBLOCKSIZE);
-	_block* solstack = (_block*) calloc(pbbm->nblocks*blocklen, sizeof(_block));
+    //+1: index extraction reads one word ahead
+	_block* solstack = (_block*) calloc_aligned(pbbm->nblocks*ROW_STRIDE(blocklen) + 1, sizeof(_block));
    
     if (pCount != NULL)
         *pCount = 0;
     
     ale[0].u = solstack;
-    ale[0].next = ale[0].LUT[0];
+    ale[0].next = ale[0].bucket[LUT_BUCKET(&ale[0], 0)];
+    ale[0].end  = ale[0].bucket[LUT_BUCKET(&ale[0], 0) + 1];
     ale[0].val = 0;
     
     //redundant - stored in total
     //gp_experiment->lookups++;
 
-    total = solve_it(ale, pbbm, 0, solstack, pCount, pXors, weight, abort, report_solution);
+    total = solve_it(ale, pbbm, 0, 0, solstack, pCount, pXors, weight, abort, report_solution, report_data, NULL, monitor);
     //free(myword);
-    free(solstack);
+    free_aligned(solstack);
     
     return total;
 }
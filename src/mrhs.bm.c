@@ -3,16 +3,51 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
 #include "mrhs.bm.h"
 #include "mrhs.bv.h"
 #include "mrhs.solver.h"
 
 
+////////////////////////////////////////////////////////////////////////
+// Aligned memory
+
+/// zero filled memory aligned to MEMORY_ALIGN, release with free_aligned
+void* calloc_aligned(size_t count, size_t size)
+{
+    void *ptr = NULL;
+    size_t bytes = count * size;
+
+    //round up, keeps vector loads at the end inside the allocation
+    bytes = (bytes + MEMORY_ALIGN - 1) / MEMORY_ALIGN * MEMORY_ALIGN;
+#ifdef _MSC_VER
+    ptr = _aligned_malloc(bytes, MEMORY_ALIGN);
+#else
+    if (posix_memalign(&ptr, MEMORY_ALIGN, bytes) != 0)
+        ptr = NULL;
+#endif
+    if (ptr != NULL)
+        memset(ptr, 0, bytes);
+    return ptr;
+}
+
+void free_aligned(void *ptr)
+{
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////
 // BM Constructors and destructors
 
 /// Creates a dynamic BitMatrix with nrows and ncols,
-/// alloc: array of blocks
+/// alloc: array of blocks, aligned to MEMORY_ALIGN
 _bm create_bm(int nrows, int ncols)
 {
     _bm bm;
@@ -29,7 +64,7 @@ _bm create_bm(int nrows, int ncols)
     bm.ncols = ncols;
     bm.nrows = nrows;
 
-    bm.rows = (_block*) calloc(nrows, sizeof(_block));
+    bm.rows = (_block*) calloc_aligned(nrows, sizeof(_block));
 
     return bm;
 }
@@ -38,7 +73,7 @@ _bm create_bm(int nrows, int ncols)
 ///free space allocated to internal _bm structures
 void clear_bm(_bm* pbm)
 {
-	if (pbm->rows != NULL) { free(pbm->rows); }
+	if (pbm->rows != NULL) { free_aligned(pbm->rows); }
 
     pbm->rows  = NULL;
     pbm->nrows = 0;
@@ -66,26 +101,79 @@ void set_bit_bm(_bm *bm, int row, int col, _block bit)
 ////////////////////////////////////////////////////////////////////////////////
 // Utility functions - random generation
 
-_block random_block()
+#if (RNG_MS_RAND)
+
+///sets seed of the generator (srand)
+void seed_rng(_rng *rng, unsigned int seed)
+{
+	rng->state = seed;
+}
+
+///next random number in [0, RNG_MAX] (rand)
+int next_rng(_rng *rng)
+{
+	rng->state = rng->state * 214013u + 2531011u;
+	return (int) ((rng->state >> 16) & RNG_MAX);
+}
+
+#else
+
+///sets seed of the generator (srand of glibc)
+void seed_rng(_rng *rng, unsigned int seed)
+{
+	int32_t word, hi, lo;
+	int i;
+
+	//r[i] = 16807 * r[i-1] % (2^31 - 1), Schrage's method
+	word = (seed == 0) ? 1 : (int32_t) seed;
+	rng->r[0] = (uint32_t) word;
+	for (i = 1; i < 31; i++)
+	{
+		hi = word / 127773;
+		lo = word % 127773;
+		word = 16807 * lo - 2836 * hi;
+		if (word < 0)
+			word += 2147483647;
+		rng->r[i] = (uint32_t) word;
+	}
+	//r[31..33] = r[0..2], first 310 outputs are dropped
+	rng->pos = 3;
+	for (i = 0; i < 310; i++)
+		next_rng(rng);
+}
+
+///next random number in [0, RNG_MAX] (rand of glibc)
+int next_rng(_rng *rng)
+{
+	uint32_t value = rng->r[rng->pos] + rng->r[(rng->pos + 28) % 31];
+
+	rng->r[rng->pos] = value;
+	rng->pos = (rng->pos + 1) % 31;
+	return (int) (value >> 1);
+}
+
+#endif
+
+_block random_block(_rng *rng)
 {
-	return (((_block)rand()) << 32) ^ ((_block)rand() & (_block)0xffffffff);
+	return (((_block)next_rng(rng)) << 32) ^ ((_block)next_rng(rng) & (_block)0xffffffff);
 }
 
 ///fill in with random values
-void random_bm(_bm *pbm)
+void random_bm(_bm *pbm, _rng *rng)
 {
 	int row;
 	_block mask = BLOCK_MASK(pbm->ncols);
 
 	for (row = 0; row < pbm->nrows; row++)
 	{
-		pbm->rows[row] = random_block() & mask;
+		pbm->rows[row] = random_block(rng) & mask;
 	}
 }
 
 ///fill in with unique random values
 /// PRE:
-void random_unique_bm(_bm *pbm)
+void random_unique_bm(_bm *pbm, _rng *rng)
 {
     int filled, row;
     _block mask = BLOCK_MASK(pbm->ncols), value, tmp;
@@ -93,7 +181,7 @@ void random_unique_bm(_bm *pbm)
     for (filled = 0; filled < pbm->nrows; filled++)
     {
         //generate value, and insert sort it
-        value = random_block() & mask;
+        value = random_block(rng) & mask;
         for (row = 0; row < filled; row++)
         {
             //should value be inserted here?
@@ -125,12 +213,12 @@ void random_unique_bm(_bm *pbm)
 
 ///fill in pbm based on AND gate + random constant
 /// PRE: nrows = 4, ncols = 3
-void random_and_bm(_bm *pbm)
+void random_and_bm(_bm *pbm, _rng *rng)
 {
     if (pbm->nrows != 4 || pbm->ncols != 3)
         return;
 
-    _block constant = random_block() & BLOCK_MASK(pbm->ncols); 
+    _block constant = random_block(rng) & BLOCK_MASK(pbm->ncols); 
 
     pbm->rows[0] = 0x0 ^ constant;  //000 + c
     pbm->rows[1] = 0x1 ^ constant;  //001 + c
@@ -140,7 +228,7 @@ void random_and_bm(_bm *pbm)
 
 ///fill in with random values for AND inputs, and single one for AND output,
 /// PRE: ncols = 3, output_row < nrows
-void random_and_cols_bm(_bm *pbm, int output_row)
+void random_and_cols_bm(_bm *pbm, int output_row, _rng *rng)
 {
     if (pbm->nrows < output_row || output_row < 0 || pbm->ncols != 3)
         return;
@@ -151,7 +239,7 @@ void random_and_cols_bm(_bm *pbm, int output_row)
 
 	for (row = 0; row < output_row; row++)
 	{
-		pbm->rows[row] = random_block() & mask;
+		pbm->rows[row] = random_block(rng) & mask;
 	}
 
     //special output_row
@@ -161,7 +249,7 @@ void random_and_cols_bm(_bm *pbm, int output_row)
 
 ///fill in with random values for AND inputs, and single one for AND output,
 /// PRE: ncols = 3, output_row < nrows
-void random_sparse_and_cols_bm(_bm *pbm, int output_row, int density)
+void random_sparse_and_cols_bm(_bm *pbm, int output_row, int density, _rng *rng)
 {
     int special = 0, row, col;
     _block mask;
@@ -187,7 +275,7 @@ void random_sparse_and_cols_bm(_bm *pbm, int output_row, int density)
         //set active variable 1
         for (int i = 0; i <= density; i++)
         {
-            row = rand() % output_row;        
+            row = next_rng(rng) % output_row;        
             pbm->rows[row] |= mask;
         }
 	}    
@@ -196,7 +284,7 @@ void random_sparse_and_cols_bm(_bm *pbm, int output_row, int density)
 ///fill in with random values,
 ///    single    one to each column, linearly independent
 /// for correct lin independence PRE: pbm->nrows >> pbm->ncols
-void random_sparse_cols_bm(_bm *pbm)
+void random_sparse_cols_bm(_bm *pbm, _rng *rng)
 {
 	int row, col;
 	_block mask;
@@ -205,7 +293,7 @@ void random_sparse_cols_bm(_bm *pbm)
 	{
 		mask = (ONE<<col);
 
-		row = rand() % pbm->nrows;
+		row = next_rng(rng) % pbm->nrows;
 		//after && -> failsafe for system with low number of unknowns
 		if (pbm->rows[row] != ZERO && pbm->ncols < pbm->nrows)
 		{
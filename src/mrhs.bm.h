@@ -35,7 +35,7 @@ typedef uint64_t _block;
 typedef struct {
    int nrows;          // number of rows
    int ncols;		   // number of columns
-   _block *rows;       // storage: array of blocks
+   _block *rows;       // storage: array of blocks, aligned to MEMORY_ALIGN
 } _bm;
 
 
@@ -51,8 +51,15 @@ typedef struct {
 /// --------------------------------------------------------------------
 /// Alloc/dealloc
 
+//alignment of bulk storage (cache line)
+#define MEMORY_ALIGN    64
+
+/// zero filled memory aligned to MEMORY_ALIGN, release with free_aligned
+void* calloc_aligned(size_t count, size_t size);
+void free_aligned(void *ptr);
+
 /// Creates a dynamic BlockBitMatrix with nrows and ncols,
-/// alloc: array of pointers
+/// alloc: array of blocks, aligned to MEMORY_ALIGN (release with clear_bm)
 _bm create_bm(int nrows, int ncols);
 
 ///free space allocated to internal _bbm structures
@@ -68,29 +75,62 @@ void set_bit_bm(_bm *bm, int row, int col, _block bit);
 /// --------------------------------------------------------------------
 /// Random data
 
+///state of reentrant random generator (one per solver context or thread)
+/// sequence of rand() of the C runtime, generated systems match the earlier seeds:
+///   RNG_MS_RAND (default on Windows): MS C runtime, otherwise glibc (TYPE_3 additive generator)
+/// define RNG_MS_RAND=1 or 0 to generate the systems of the other platform
+#ifndef RNG_MS_RAND
+#ifdef _WIN32
+#define RNG_MS_RAND 1
+#else
+#define RNG_MS_RAND 0
+#endif
+#endif
+
+#if (RNG_MS_RAND)
+typedef struct {
+   uint32_t state;
+} _rng;
+
+#define RNG_MAX 0x7fff
+#else
+typedef struct {
+   uint32_t r[31];      //last 31 values of r[i] = r[i-31] + r[i-3]
+   int pos;             //slot of r[i-31], replaced by next value
+} _rng;
+
+#define RNG_MAX 0x7fffffff
+#endif
+
+///sets seed of the generator
+void seed_rng(_rng *rng, unsigned int seed);
+
+///next random number in [0, RNG_MAX]
+int next_rng(_rng *rng);
+
 /// random block matrix
-void random_bm(_bm *pbm);
+void random_bm(_bm *pbm, _rng *rng);
 
 ///fill in with unique random values
 /// PRE: pbm->nrows < ((ONE) << pbm->ncols)
-void random_unique_bm(_bm *pbm);
+void random_unique_bm(_bm *pbm, _rng *rng);
 
 ///fill in with random values,
 ///    single    one to each column, linearly independent
-void random_sparse_cols_bm(_bm *pbm);
+void random_sparse_cols_bm(_bm *pbm, _rng *rng);
 
 
 ///fill in pbm based on AND gate + random constant
 /// PRE: nrows = 4, ncols = 3
-void random_and_bm(_bm *pbm);
+void random_and_bm(_bm *pbm, _rng *rng);
 
 ///fill in with random values for AND inputs, and single one for AND output,
 /// PRE: ncols = 3, output_row < nrows
-void random_and_cols_bm(_bm *pbm, int output_row);
+void random_and_cols_bm(_bm *pbm, int output_row, _rng *rng);
 
 ///fill in with random sparse values for AND inputs (pc+key), and single one for AND output,
 /// PRE: ncols = 3
-void random_sparse_and_cols_bm(_bm *pbm, int output_row, int density);
+void random_sparse_and_cols_bm(_bm *pbm, int output_row, int density, _rng *rng);
 
 
 /// --------------------------------------------------------------------
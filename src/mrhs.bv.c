@@ -179,21 +179,21 @@ void print_bv(_bv *bv, FILE* f)
 }
 
 ///print bit vector to file
-void random_bv(_bv *bv)
+void random_bv(_bv *bv, _rng *rng)
 {
 	int block = 0;
 	_block bits;
 	for (block = 0; block < bv->nblocks-1; block++)
 	{
-		bits = (rand() & 0xffffull) ^
-                         ((rand() & 0xffffull) << 16) ^
-                         ((rand() & 0xffffull) << 32) ^
-                         ((rand() & 0xffffull) << 48);
+		bits = (next_rng(rng) & 0xffffull) ^
+                         ((next_rng(rng) & 0xffffull) << 16) ^
+                         ((next_rng(rng) & 0xffffull) << 32) ^
+                         ((next_rng(rng) & 0xffffull) << 48);
         bv->row[block] = bits;
 	}
-    bits = (rand() & 0xffffull) ^
-                         ((rand() & 0xffffull) << 16) ^
-                         ((rand() & 0xffffull) << 32) ^
-                         ((rand() & 0xffffull) << 48);
+    bits = (next_rng(rng) & 0xffffull) ^
+                         ((next_rng(rng) & 0xffffull) << 16) ^
+                         ((next_rng(rng) & 0xffffull) << 32) ^
+                         ((next_rng(rng) & 0xffffull) << 48);
     bv->row[block] = bits & BLOCK_MASK(LASTBLOCKSIZE(bv->ncols));
 }
@@ -28,7 +28,7 @@ _bv create_bv(int ncols);
 void clear_bv(_bv* pbv);
 
 ///random bit vector
-void random_bv(_bv* pbv);
+void random_bv(_bv* pbv, _rng *rng);
 
 
 _block is_non_zero_bv(_bv *bv);
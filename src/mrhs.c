@@ -77,23 +77,23 @@ void clear_MRHS(MRHS_system *psystem)
 /// ///////////////////////////////////////////////////////////////////
 
 /// Fill MRHS system with random data
-void fill_mrhs_random(MRHS_system *psystem)
+void fill_mrhs_random(MRHS_system *psystem, _rng *rng)
 {
 	for (int block = 0; block < psystem->nblocks; block++)
 	{
-		random_bm(&psystem->pM[block]);
-		random_unique_bm(&psystem->pS[block]);
+		random_bm(&psystem->pM[block], rng);
+		random_unique_bm(&psystem->pS[block], rng);
 	}
 }
 
 /// Fill MRHS system with random data,
 ///   single one in each linearly independent column
-void fill_mrhs_random_sparse(MRHS_system *psystem)
+void fill_mrhs_random_sparse(MRHS_system *psystem, _rng *rng)
 {
 	for (int block = 0; block < psystem->nblocks; block++)
 	{
-		random_sparse_cols_bm(&psystem->pM[block]);
-		random_unique_bm(&psystem->pS[block]);
+		random_sparse_cols_bm(&psystem->pM[block], rng);
+		random_unique_bm(&psystem->pS[block], rng);
 	}
 }
 
@@ -107,7 +107,7 @@ void fill_mrhs_random_sparse(MRHS_system *psystem)
 ///   PRE: ncols in each block == 3, rhs in each block == 4
 ///   PRE: 0 <= l <= nblocks
 ///   PRE: nrows == k+m-l 
-void fill_mrhs_and(MRHS_system *psystem, int k, int l)
+void fill_mrhs_and(MRHS_system *psystem, int k, int l, _rng *rng)
 {
     int m = psystem->nblocks;
     if (l > m || l < 0 || k + m - l != psystem->pM->nrows)
@@ -115,13 +115,13 @@ void fill_mrhs_and(MRHS_system *psystem, int k, int l)
     
 	for (int block = 0; block < m-l; block++)
 	{
-		random_and_cols_bm(&psystem->pM[block], k+block);
-		random_and_bm(&psystem->pS[block]);
+		random_and_cols_bm(&psystem->pM[block], k+block, rng);
+		random_and_bm(&psystem->pS[block], rng);
 	}
 	for (int block = m-l; block < m; block++)
 	{
-		random_bm(&psystem->pM[block]);
-		random_and_bm(&psystem->pS[block]);
+		random_bm(&psystem->pM[block], rng);
+		random_and_bm(&psystem->pS[block], rng);
 	}
 }
 
@@ -135,7 +135,7 @@ void fill_mrhs_and(MRHS_system *psystem, int k, int l)
 ///   PRE: ncols in each block == 3, rhs in each block == 4
 ///   PRE: 0 <= l <= nblocks
 ///   PRE: nrows == k+m-l 
-void fill_mrhs_and_sparse(MRHS_system *psystem, int k, int l, int density)
+void fill_mrhs_and_sparse(MRHS_system *psystem, int k, int l, int density, _rng *rng)
 {
     int m = psystem->nblocks;
     if (l > m || l < 0 || k + m - l != psystem->pM->nrows)
@@ -143,34 +143,34 @@ void fill_mrhs_and_sparse(MRHS_system *psystem, int k, int l, int density)
     
 	for (int block = 0; block < psystem->nblocks; block++)
 	{
-		random_sparse_and_cols_bm(&psystem->pM[block], k+block, density);
-		random_and_bm(&psystem->pS[block]);
+		random_sparse_and_cols_bm(&psystem->pM[block], k+block, density, rng);
+		random_and_bm(&psystem->pS[block], rng);
 	}
 }
 
 
 /// Fill MRHS system with random data
 ///  M is sparse -> one 1 in each column + density number of ones
-void fill_mrhs_random_sparse_extra(MRHS_system *psystem, int density)
+void fill_mrhs_random_sparse_extra(MRHS_system *psystem, int density, _rng *rng)
 {
-	fill_mrhs_random_sparse(psystem);
+	fill_mrhs_random_sparse(psystem, rng);
 	for (int i = 0; i < density; i++)
     {
-		int block = rand() % psystem->nblocks;
-		int row   = rand() % psystem->pM[block].nrows;
-		int col   = rand() % psystem->pM[block].ncols;
+		int block = next_rng(rng) % psystem->nblocks;
+		int row   = next_rng(rng) % psystem->pM[block].nrows;
+		int col   = next_rng(rng) % psystem->pM[block].ncols;
 		set_one_bm(&psystem->pM[block], row, col);
 	}
 }
 
 /// Change RHS to ensure system has at least one random solution
-void ensure_random_solution(MRHS_system *psystem)
+void ensure_random_solution(MRHS_system *psystem, _rng *rng)
 {
     if (psystem->nblocks < 1)
         return;
 
     _bv sol = create_bv(psystem->pM[0].nrows);
-    random_bv(&sol);
+    random_bv(&sol, rng);
 
     for (int block = 0; block < psystem->nblocks; block++)
     {
@@ -225,7 +225,7 @@ MRHS_system read_mrhs_variable(FILE *f)
 			read_block_bm(f, system.pM[block], row);
 		}
 		//remove terminator
-		fscanf(f, "]\n");
+		fscanf(f, " ]\n");
 	}
 
 	//read blocks of S
@@ -239,7 +239,7 @@ MRHS_system read_mrhs_variable(FILE *f)
 			read_block_bm(f, system.pS[block], row);
 
 			//remove terminator
-			fscanf(f, "]\n");
+			fscanf(f, " ]\n");
 		}
 	}
 
@@ -450,6 +450,12 @@ int linear_substitution(MRHS_system *system, _bv *column, _block rhs)
 
 ///remove linear equations from the system
 int remove_linear(MRHS_system *system)
+{
+   return remove_linear_log(system, NULL);
+}
+
+///remove linear equations from the system, substituted equations are appended to log (NULL: none)
+int remove_linear_log(MRHS_system *system, MRHS_linear_log *log)
 {
    int count = 0;
    for (int block = 0; block < system->nblocks; block++)
@@ -461,12 +467,32 @@ int remove_linear(MRHS_system *system)
                 _bv column = get_column_bm(&system->pM[block], col);
                 _block rhs = get_bit_bm(&system->pS[block], 0, col);
                 count += linear_substitution(system, &column, rhs);
-                clear_bv(&column);
+                if (log != NULL && find_nonzero(&column, 0) >= 0)
+                {
+                    log->columns = realloc(log->columns, (log->count + 1) * sizeof(_bv));
+                    log->rhs     = realloc(log->rhs, (log->count + 1) * sizeof(_block));
+                    log->columns[log->count] = column;
+                    log->rhs[log->count]     = rhs;
+                    log->count++;
+                }
+                else
+                    clear_bv(&column);
             }
         }
    }
    return count;
 }
+
+void clear_linear_log(MRHS_linear_log *log)
+{
+    for (int i = 0; i < log->count; i++)
+        clear_bv(&log->columns[i]);
+    free(log->columns);
+    free(log->rhs);
+    log->count   = 0;
+    log->columns = NULL;
+    log->rhs     = NULL;
+}
 ///remove linear equations from the system
 int remove_empty(MRHS_system *system)
 {
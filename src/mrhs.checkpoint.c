@@ -0,0 +1,432 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * library file: checkpoint and resume of RZ search
+ *
+ * v1.8: state of serial search is written periodically (atomic replace),
+ *       search continues from stored cursors,
+ *       solutions found so far are stored as paths and reported again on resume
+ *
+ * File (native byte order): magic, system hash, nblocks, stride, max_weight,
+ *       depth (-1 = search finished), weight, counters, number of solutions,
+ *       cursors of each level, u-stack,
+ *       solutions (weight and LUT entry of each level)
+ **********************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "mrhs.bm.h"
+#include "mrhs.simd.h"
+#include "mrhs.solver.h"
+#include "mrhs.checkpoint.h"
+
+#define CHECKPOINT_MAGIC "MRHSCP02"
+
+//stored state of one level
+typedef struct {
+    int32_t next, end;
+    int32_t weight;
+    int32_t u;          //offset of ale[b].u in u-stack, -1 below depth
+    uint64_t val;
+} CheckpointLevel;
+
+typedef struct {
+    char magic[8];
+    uint64_t hash;
+    int32_t nblocks;
+    int32_t stride;
+    int32_t max_weight;
+    int32_t block;      //depth of the search, -1: finished
+    int32_t weight;
+    int64_t count, total, xors;
+    int64_t solutions;  //stored paths of solutions
+} CheckpointHeader;
+
+//monitor data
+typedef struct {
+    const char *file;
+    int interval;
+    time_t last;
+    _block *solstack;
+    CheckpointHeader base;  //counters of resumed part and of this run so far
+    SearchMonitor *next;    //chained monitors, called by the checkpoint hook
+    sol_rep_fn_t report_solution;   //caller's reporting, wrapped by checkpoint_report
+    void *report_data;
+    int abort;              //early abort of the caller (report_solution returns 0 to stop)
+    int stopped;            //search stopped early (abort or monitor) at block, weight
+    int block, weight;
+    int32_t *paths;         //reported solutions: weight, ale[b].next-1 of each level (nblocks+1 values each)
+    long long int size;     //allocated paths
+} CheckpointState;
+
+////////////////////////////////////////////////////////////////////////////////
+// Hash
+
+//FNV-1a
+static uint64_t hash_add(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char*) data;
+    while (len--)
+    {
+        hash ^= *p++;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/// hash of prepared system (echelonized matrix and LUTs)
+uint64_t get_system_hash(ActiveListEntry* ale, _bbm *pbbm)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    int block, row, i, weight;
+    _block value;
+
+    hash = hash_add(hash, &pbbm->nblocks, sizeof(int));
+    hash = hash_add(hash, &pbbm->nrows, sizeof(int));
+    hash = hash_add(hash, pbbm->blocksizes, pbbm->nblocks * sizeof(int));
+    hash = hash_add(hash, pbbm->pivots, pbbm->nblocks * sizeof(int));
+    for (row = 0; row < pbbm->nrows; row++)
+        hash = hash_add(hash, pbbm->rows[row], pbbm->nblocks * sizeof(_block));
+
+    for (block = 0; block < pbbm->nblocks; block++)
+    {
+        hash = hash_add(hash, ale[block].bucket, (ale[block].nbuckets + 1) * sizeof(int));
+        if (ale[block].keys != NULL)
+            hash = hash_add(hash, ale[block].keys, ale[block].nbuckets * sizeof(_block));
+        //shared LUT: entries as translated to the block
+        if (ale[block].shared != NULL)
+            hash = hash_add(hash, &ale[block].xidx, sizeof(_block));
+        for (i = 0; i < ale[block].bucket[ale[block].nbuckets]; i++)
+        {
+            value  = ENTRY_VALUE(&ale[block], i);
+            weight = ENTRY_WEIGHT(&ale[block], i);
+            hash = hash_add(hash, &value, sizeof(_block));
+            hash = hash_add(hash, &weight, sizeof(int));
+        }
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// File I/O
+
+//write to temporary file, then replace the checkpoint
+static int write_checkpoint(CheckpointState *cs, ActiveListEntry* ale, _bbm *pbbm, CheckpointHeader *hdr)
+{
+    char *tmp;
+    FILE *f;
+    int b, ok;
+    CheckpointLevel level;
+    size_t words = (size_t) pbbm->nblocks * hdr->stride + 1;
+
+    tmp = (char*) malloc(strlen(cs->file) + 5);
+    sprintf(tmp, "%s.tmp", cs->file);
+    f = fopen(tmp, "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Cannot write checkpoint: %s\n", tmp);
+        free(tmp);
+        return 0;
+    }
+
+    ok = (fwrite(hdr, sizeof(CheckpointHeader), 1, f) == 1);
+    for (b = 0; b < pbbm->nblocks && ok; b++)
+    {
+        memset(&level, 0, sizeof(level));
+        level.u = -1;
+        if (b <= hdr->block)
+        {
+            level.next   = ale[b].next;
+            level.end    = ale[b].end;
+            level.weight = ale[b].weight;
+            level.u      = (int32_t) (ale[b].u - cs->solstack);
+            level.val    = ale[b].val;
+        }
+        ok = (fwrite(&level, sizeof(level), 1, f) == 1);
+    }
+    if (ok)
+        ok = (fwrite(cs->solstack, sizeof(_block), words, f) == words);
+    if (ok && hdr->solutions > 0)
+        ok = (fwrite(cs->paths, sizeof(int32_t) * (pbbm->nblocks + 1), (size_t) hdr->solutions, f)
+              == (size_t) hdr->solutions);
+    ok = (fflush(f) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp, cs->file, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && (rename(tmp, cs->file) == 0);
+#endif
+    if (!ok)
+        fprintf(stderr, "Cannot write checkpoint: %s\n", cs->file);
+    free(tmp);
+    return ok;
+}
+
+//append path of solution found at the last level (cursors ale[b].next-1)
+static void store_path(CheckpointState *cs, ActiveListEntry* ale, _bbm *pbbm, int weight)
+{
+    int32_t *path;
+    int b;
+
+    if (cs->base.solutions == cs->size)
+    {
+        cs->size  = (cs->size == 0) ? 64 : 2*cs->size;
+        cs->paths = (int32_t*) realloc(cs->paths, (size_t) cs->size * (pbbm->nblocks + 1) * sizeof(int32_t));
+    }
+    path = cs->paths + (size_t) cs->base.solutions * (pbbm->nblocks + 1);
+    path[0] = weight;
+    for (b = 0; b < pbbm->nblocks; b++)
+        path[b + 1] = ale[b].next - 1;
+    cs->base.solutions++;
+}
+
+//restore state of cs->base and stored paths, returns 0 if the file does not match the prepared system
+static int read_checkpoint(CheckpointState *cs, const char *file, ActiveListEntry* ale, _bbm *pbbm, int max_weight)
+{
+    FILE *f;
+    int b, ok;
+    CheckpointLevel level;
+    CheckpointHeader *hdr = &cs->base;
+    _block *solstack = cs->solstack;
+    size_t words;
+    long long int i;
+    int32_t *path;
+
+    f = fopen(file, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Cannot read checkpoint: %s\n", file);
+        return 0;
+    }
+
+    ok = (fread(hdr, sizeof(CheckpointHeader), 1, f) == 1)
+      && memcmp(hdr->magic, CHECKPOINT_MAGIC, 8) == 0;
+    if (ok && (hdr->hash != get_system_hash(ale, pbbm) || hdr->nblocks != pbbm->nblocks
+               || hdr->stride != ROW_STRIDE(GET_BL(pbbm->ncols)) || hdr->max_weight != max_weight))
+    {
+        fprintf(stderr, "Checkpoint %s belongs to a different system or search\n", file);
+        fclose(f);
+        return 0;
+    }
+
+    words = (size_t) pbbm->nblocks * hdr->stride + 1;
+    for (b = 0; b < pbbm->nblocks && ok; b++)
+    {
+        ok = (fread(&level, sizeof(level), 1, f) == 1);
+        if (ok && b <= hdr->block)
+        {
+            ok = (level.u >= 0 && (size_t) level.u < words
+                  && level.next >= 0 && level.end <= ale[b].bucket[ale[b].nbuckets]);
+            ale[b].next   = level.next;
+            ale[b].end    = level.end;
+            ale[b].weight = level.weight;
+            ale[b].u      = solstack + (ok ? level.u : 0);
+            ale[b].val    = level.val;
+        }
+    }
+    if (ok)
+        ok = (fread(solstack, sizeof(_block), words, f) == words);
+    if (ok && hdr->solutions > 0)
+    {
+        cs->size  = hdr->solutions;
+        cs->paths = (int32_t*) malloc((size_t) cs->size * (pbbm->nblocks + 1) * sizeof(int32_t));
+        ok = (fread(cs->paths, sizeof(int32_t) * (pbbm->nblocks + 1), (size_t) hdr->solutions, f)
+              == (size_t) hdr->solutions);
+        for (i = 0; i < hdr->solutions && ok; i++)
+        {
+            path = cs->paths + (size_t) i * (pbbm->nblocks + 1);
+            for (b = 0; b < pbbm->nblocks && ok; b++)
+                ok = (path[b + 1] >= 0 && path[b + 1] < ale[b].bucket[ale[b].nbuckets]);
+        }
+    }
+    fclose(f);
+
+    if (!ok)
+        fprintf(stderr, "Invalid checkpoint: %s\n", file);
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Search
+
+static int checkpoint_hook(SearchMonitor *monitor, ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                           long long int count, long long int total, long long int xors)
+{
+    CheckpointState *cs = (CheckpointState*) monitor->data;
+    time_t now = time(NULL);
+
+    //counters since previous call
+    cs->base.count += count;
+    cs->base.total += total;
+    cs->base.xors  += xors;
+
+    //chained monitor stops the search: state at the top of the loop
+    if (call_monitors(cs->next, ale, pbbm, block, weight, count, total, xors))
+    {
+        cs->stopped = 1;
+        cs->block   = block;
+        cs->weight  = weight;
+        return 1;
+    }
+
+    if (now - cs->last < cs->interval)
+        return 0;
+    cs->last = now;
+
+    cs->base.block  = block;
+    cs->base.weight = weight;
+    write_checkpoint(cs, ale, pbbm, &cs->base);
+    return 0;
+}
+
+//solutions of resumed part are reported first (see replay_solutions), path is stored for the checkpoint
+//early abort: search stops after the reported entry of the last block, resume continues with its siblings
+static int checkpoint_report(long long int counter, _bbm *pbbm, ActiveListEntry* ale, int weight, void *data)
+{
+    CheckpointState *cs = (CheckpointState*) data;
+    int retval;
+
+    (void) counter;
+    store_path(cs, ale, pbbm, weight);
+    retval = cs->report_solution(cs->base.solutions, pbbm, ale, weight, cs->report_data);
+
+    if (!retval && cs->abort == 1)
+    {
+        cs->stopped = 1;
+        cs->block   = pbbm->nblocks - 1;
+        cs->weight  = weight - ale[pbbm->nblocks - 1].weight;
+    }
+    return retval;
+}
+
+//stored solutions of the resumed part to report_solution (cursors of the path), cursors are kept
+static void replay_solutions(CheckpointState *cs, ActiveListEntry* ale, _bbm *pbbm)
+{
+    int *next = (int*) malloc(pbbm->nblocks * sizeof(int));
+    int32_t *path;
+    long long int i;
+    int b;
+
+    for (b = 0; b < pbbm->nblocks; b++)
+        next[b] = ale[b].next;
+    for (i = 0; i < cs->base.solutions; i++)
+    {
+        path = cs->paths + (size_t) i * (pbbm->nblocks + 1);
+        for (b = 0; b < pbbm->nblocks; b++)
+            ale[b].next = path[b + 1] + 1;
+        //found before, early abort does not apply
+        cs->report_solution(i + 1, pbbm, ale, path[0], cs->report_data);
+    }
+    for (b = 0; b < pbbm->nblocks; b++)
+        ale[b].next = next[b];
+    free(next);
+}
+
+/// serial search with periodic checkpoints
+/// file: checkpoint written every interval seconds and at the end (NULL: none)
+/// resume: checkpoint to continue from (NULL: new search)
+/// *pCount, *pXors: including resumed part, solutions of the resumed part are reported again
+/// monitor: chained after the checkpoint hook (NULL: none)
+/// returns visited nodes including resumed part, -1 if resume failed
+long long int solve_checkpoint(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors,
+                               int weight, int abort, sol_rep_fn_t report_solution, void *report_data,
+                               const char *file, int interval, const char *resume, SearchMonitor *monitor)
+{
+    long long int total = 0, count = 0, xors = 0, start_count, start_total, start_xors;
+    int stride = ROW_STRIDE(GET_BL(pbbm->ncols));
+    //+1: index extraction reads one word ahead
+    _block *solstack = (_block*) calloc_aligned((size_t) pbbm->nblocks * stride + 1, sizeof(_block));
+    CheckpointState cs;
+    SearchMonitor hook;
+
+    memset(&cs.base, 0, sizeof(CheckpointHeader));
+    memcpy(cs.base.magic, CHECKPOINT_MAGIC, 8);
+    cs.base.hash       = get_system_hash(ale, pbbm);
+    cs.base.nblocks    = pbbm->nblocks;
+    cs.base.stride     = stride;
+    cs.base.max_weight = weight;
+    cs.file     = file;
+    cs.interval = (interval > 0) ? interval : CHECKPOINT_INTERVAL;
+    cs.last     = time(NULL);
+    cs.solstack = solstack;
+    cs.next     = monitor;
+    cs.report_solution = report_solution;
+    cs.report_data     = report_data;
+    cs.abort    = abort;
+    cs.stopped  = 0;
+    cs.paths    = NULL;
+    cs.size     = 0;
+
+    if (pCount != NULL)
+        *pCount = 0;
+
+    if (resume != NULL)
+    {
+        if (!read_checkpoint(&cs, resume, ale, pbbm, weight))
+        {
+            free(cs.paths);
+            free_aligned(solstack);
+            return -1;
+        }
+#if (_VERBOSITY > 1)
+        fprintf(stdout, "Resumed from %s: %lld solutions, %lld nodes, depth %d\n",
+                resume, (long long int) cs.base.count, (long long int) cs.base.total, cs.base.block);
+#endif
+        if (report_solution != NULL)
+            replay_solutions(&cs, ale, pbbm);
+    }
+    else
+    {
+        ale[0].u = solstack;
+        ale[0].next = ale[0].bucket[LUT_BUCKET(&ale[0], 0)];
+        ale[0].end  = ale[0].bucket[LUT_BUCKET(&ale[0], 0) + 1];
+        ale[0].val = 0;
+        cs.base.block  = 0;
+        cs.base.weight = 0;
+    }
+
+    //hook adds counters of this run as they come, the rest is added at the end
+    start_count = cs.base.count;
+    start_total = cs.base.total;
+    start_xors  = cs.base.xors;
+    if (cs.base.block >= 0)
+    {
+        hook.interval = MONITOR_INTERVAL;
+        hook.fn       = checkpoint_hook;
+        hook.data     = &cs;
+        hook.next     = NULL;   //called from the hook
+        total = solve_from(ale, pbbm, cs.base.block, cs.base.weight, solstack, &count, &xors, weight, abort,
+                           report_solution != NULL ? checkpoint_report : NULL, &cs,
+                           file != NULL ? &hook : monitor);
+    }
+
+    //final state: finished, or position where the search stopped early
+    cs.base.count = start_count + count;
+    cs.base.total = start_total + total;
+    cs.base.xors  = start_xors  + xors;
+    if (file != NULL)
+    {
+        cs.base.block  = cs.stopped ? cs.block : -1;
+        cs.base.weight = cs.stopped ? cs.weight : 0;
+        write_checkpoint(&cs, ale, pbbm, &cs.base);
+    }
+
+    if (pCount != NULL)
+        *pCount = cs.base.count;
+    if (pXors != NULL)
+        *pXors += cs.base.xors;
+
+    free(cs.paths);
+    free_aligned(solstack);
+    return cs.base.total;
+}
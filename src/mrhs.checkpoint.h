@@ -0,0 +1,31 @@
+/***
+ * MRHS solver: checkpoint and resume of RZ search
+ *
+ * State of the non-recursive search: cursors of ale[] (entry indices),
+ * u-stack, depth, weight and counters, with hash of the prepared system,
+ * paths of solutions found so far
+ */
+
+#ifndef _MRHS_CHECKPOINT_H
+#define _MRHS_CHECKPOINT_H
+
+#include "mrhs.bm.h"
+#include "mrhs.solver.h"
+
+//default time between checkpoints in seconds
+#define CHECKPOINT_INTERVAL 600
+
+/// serial search with periodic checkpoints
+/// file: checkpoint written every interval seconds and at the end (NULL: none)
+/// resume: checkpoint to continue from (NULL: new search)
+/// *pCount, *pXors: including resumed part, solutions of the resumed part are reported again
+/// monitor: chained after the checkpoint hook (NULL: none)
+/// returns visited nodes including resumed part, -1 if resume failed
+long long int solve_checkpoint(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors,
+                               int weight, int abort, sol_rep_fn_t report_solution, void *report_data,
+                               const char *file, int interval, const char *resume, SearchMonitor *monitor);
+
+/// hash of prepared system (echelonized matrix and LUTs)
+uint64_t get_system_hash(ActiveListEntry* ale, _bbm *pbbm);
+
+#endif //_MRHS_CHECKPOINT_H
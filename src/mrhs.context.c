@@ -0,0 +1,69 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * library file: solver context
+ *
+ * v1.8: results, counters and random generator moved from globals of the solvers
+ **********************************/
+
+#include <stdlib.h>
+
+#include "mrhs.bm.h"
+#include "mrhs.bv.h"
+#include "mrhs.solver.h"
+#include "mrhs.context.h"
+
+/// empty context, random generator from seed, no callback
+void init_context(MRHS_context *ctx, unsigned int seed)
+{
+    seed_rng(&ctx->rng, seed);
+    ctx->results  = NULL;
+    ctx->nresults = 0;
+    ctx->rank  = 0;
+    ctx->count = 0;
+    ctx->total = 0;
+    ctx->xors  = 0;
+    ctx->split = ctx->split_xors = 0;
+    ctx->A      = NULL;
+    ctx->report = NULL;
+    ctx->user   = NULL;
+}
+
+/// frees results and transform of the last solve, resets counters
+void clear_results(MRHS_context *ctx)
+{
+    long long int i;
+
+    for (i = 0; i < ctx->nresults; i++)
+        clear_bv(&ctx->results[i]);
+    free(ctx->results);
+    ctx->results  = NULL;
+    ctx->nresults = 0;
+
+    if (ctx->A != NULL)
+        free_bbm(ctx->A);
+    ctx->A = NULL;
+
+    ctx->rank  = 0;
+    ctx->count = 0;
+    ctx->total = 0;
+    ctx->xors  = 0;
+    ctx->split = ctx->split_xors = 0;
+}
+
+/// cleanup
+void clear_context(MRHS_context *ctx)
+{
+    clear_results(ctx);
+}
+
+/// appends solution x (context takes it over), calls the callback
+int add_result(MRHS_context *ctx, _bv x)
+{
+    ctx->results = (_bv*) realloc(ctx->results, (ctx->nresults + 1) * sizeof(_bv));
+    ctx->results[ctx->nresults++] = x;
+    if (ctx->report != NULL)
+        return ctx->report(ctx, &ctx->results[ctx->nresults - 1], ctx->user);
+    return 0;
+}
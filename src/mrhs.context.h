@@ -0,0 +1,51 @@
+/***
+ * MRHS solver: solver context
+ *
+ * All state of one solver instance: results and counters of the last solve,
+ * echelon transform, random generator and solution callback.
+ * Entry points (solve_rz, solve_gd, estimate_rz, solve_hc) keep no global state,
+ * separate contexts can be used from separate threads.
+ */
+
+#ifndef _MRHS_CONTEXT_H
+#define _MRHS_CONTEXT_H
+
+#include "mrhs.bm.h"
+#include "mrhs.bv.h"
+#include "mrhs.solver.h"
+
+struct MRHS_context;
+
+/// called for each solution found (serialized), x belongs to the context
+/// returns 0 to stop a search with abort (as sol_rep_fn_t), non-zero to continue
+typedef int (*mrhs_solution_fn)(struct MRHS_context *ctx, const _bv *x, void *user);
+
+/// solver context
+typedef struct MRHS_context {
+    _rng rng;                   // random choices of the solvers (HC restarts, estimate probes)
+    _bv *results;               // solutions of the last solve
+    long long int nresults;     // number of stored solutions
+    int rank;                   // rank of the system (RZ)
+    long long int count;        // solutions found
+    long long int total;        // visited nodes (RZ), restarts (HC), probes (estimate)
+    long long int xors;         // XORs (RZ), evaluations (HC)
+    long long int split, split_xors;    // nodes and XORs above split depth of sharded RZ search (every shard, not in total/xors)
+    _bbm *A;                    // echelon transform of the last RZ solve, packed rows (NULL: none or owned by RZ_batch)
+    mrhs_solution_fn report;    // solution callback (NULL: none)
+    void *user;                 // user data of the callback
+} MRHS_context;
+
+/// empty context, random generator from seed, no callback
+void init_context(MRHS_context *ctx, unsigned int seed);
+
+/// frees results and transform of the last solve, resets counters
+void clear_results(MRHS_context *ctx);
+
+/// cleanup
+void clear_context(MRHS_context *ctx);
+
+/// appends solution x (context takes it over), calls the callback
+/// returns result of the callback, 0 without callback (search with abort stops at the first solution)
+int add_result(MRHS_context *ctx, _bv x);
+
+#endif //_MRHS_CONTEXT_H
@@ -0,0 +1,152 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * library file: estimate of RZ search tree size
+ *
+ * v1.8: Knuth's estimator over the prepared LUTs, no solving
+ *
+ * Probe: random path from the root, at each level the entries taken by the search
+ * are counted (same pruning as the kernel), one of them continues the path.
+ * Estimate of a level = prod(choices of previous levels) * taken entries.
+ **********************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <time.h>
+
+#include "mrhs.bm.h"
+#include "mrhs.simd.h"
+#include "mrhs.solver.h"
+#include "mrhs.estimate.h"
+
+//probes between two checks of the clock
+#define ESTIMATE_CHECK 64
+
+//95% confidence interval of normal distribution
+#define ESTIMATE_Z 1.96
+
+//running mean and variance (Welford)
+typedef struct {
+    double mean, m2;
+} RunningStat;
+
+static void add_stat(RunningStat *rs, long long int n, double x)
+{
+    double delta = x - rs->mean;
+    rs->mean += delta / n;
+    rs->m2   += delta * (x - rs->mean);
+}
+
+static double ci_stat(RunningStat *rs, long long int n)
+{
+    if (n < 2)
+        return HUGE_VAL;
+    return ESTIMATE_Z * sqrt(rs->m2 / (n - 1) / n);
+}
+
+//uniform random number in [0, n), generator gives 15 bits
+static int random_below(_rng *rng, int n)
+{
+    unsigned long long int r = ((unsigned long long int) next_rng(rng) << 30)
+                             ^ ((unsigned long long int) next_rng(rng) << 15) ^ (unsigned long long int) next_rng(rng);
+    return (int) (r % (unsigned long long int) n);
+}
+
+//one random path, u: ROW_STRIDE(blocklen)+1 words (stored sm_rows are rounded to XOR_VECTOR words)
+static void probe(ActiveListEntry* ale, _bbm *pbbm, int max_weight, _block *u, _rng *rng,
+                  double *pNodes, double *pXors, double *pCount)
+{
+    double scale = 1, nodes = 0, xors = 0, count = 0;
+    int block, weight = 0, begin, end, pass, i, slot;
+    int blocklen = GET_BL(pbbm->ncols);
+    long long int added;
+    _block index = 0, value;
+    TableEntry *entries;
+
+    memset(u, 0, (ROW_STRIDE(blocklen) + 1) * sizeof(_block));
+
+    for (block = 0; block < pbbm->nblocks; block++)
+    {
+        if (ale[block].bucket == NULL)
+            load_lut(ale, block);       //lazy prepare: first visit of the block
+        entries = ale[block].entries;
+        slot    = LUT_BUCKET(&ale[block], index);
+        begin   = ale[block].bucket[slot];
+        end     = ale[block].bucket[slot + 1];
+
+        //pruned on descent
+        if (block > 0 && weight + ale[block].minw[slot] + ale[block].rest > max_weight)
+            break;
+
+        //passing entries, buckets are sorted by weight
+        added = 0;
+        for (pass = begin; pass < end && weight + ENTRY_WEIGHT(&ale[block], pass) + ale[block].rest <= max_weight; pass++)
+            if (block < pbbm->nblocks - 1 && ENTRY_VALUE(&ale[block], pass) != 0)
+                added += blocklen - (ale[block].refs != NULL ? ale[block].first : entries[pass].first);
+
+        //first failing entry is taken too
+        nodes += scale * (pass - begin + (pass < end ? 1 : 0));
+        xors  += scale * added;
+
+        if (pass == begin)
+            break;
+        if (block == pbbm->nblocks - 1)
+        {
+            count = scale * (pass - begin);
+            break;
+        }
+
+        i = begin + random_below(rng, pass - begin);
+        scale *= pass - begin;
+        weight += ENTRY_WEIGHT(&ale[block], i);
+        add_entry_row(&ale[block], i, u);
+
+        //LUT index of the next block
+        value = (u[ale[block+1].word] >> ale[block+1].shift)
+              ^ ((u[ale[block+1].word + 1] << (MAXBLOCKSIZE - 1 - ale[block+1].shift)) << 1);
+        index = value & ale[block+1].mask;
+    }
+
+    *pNodes = nodes;
+    *pXors  = xors;
+    *pCount = count;
+}
+
+/// estimates serial search of prepared system with weight bound max_weight
+/// probes until maxt seconds elapse or max_probes are done (max_probes <= 0: time only)
+/// random choices from rng
+/// returns number of probes
+long long int estimate_search(ActiveListEntry* ale, _bbm *pbbm, int max_weight, double maxt, long long int max_probes,
+                              _rng *rng, SearchEstimate *est)
+{
+    RunningStat snodes = {0, 0}, sxors = {0, 0}, scount = {0, 0};
+    long long int n = 0;
+    double nodes, xors, count;
+    clock_t start = clock();
+    //+1: index extraction reads one word ahead
+    _block *u = (_block*) calloc_aligned(ROW_STRIDE(GET_BL(pbbm->ncols)) + 1, sizeof(_block));
+
+    while (max_probes <= 0 || n < max_probes)
+    {
+        if (n % ESTIMATE_CHECK == 0 && n > 0 && (clock() - start) >= maxt * CLOCKS_PER_SEC)
+            break;
+
+        probe(ale, pbbm, max_weight, u, rng, &nodes, &xors, &count);
+        n++;
+        add_stat(&snodes, n, nodes);
+        add_stat(&sxors,  n, xors);
+        add_stat(&scount, n, count);
+    }
+    free_aligned(u);
+
+    est->probes   = n;
+    est->nodes    = snodes.mean;
+    est->nodes_ci = ci_stat(&snodes, n);
+    est->xors     = sxors.mean;
+    est->xors_ci  = ci_stat(&sxors, n);
+    est->count    = scount.mean;
+    est->count_ci = ci_stat(&scount, n);
+    return n;
+}
@@ -0,0 +1,29 @@
+/***
+ * MRHS solver: estimate of RZ search tree size
+ *
+ * Knuth's estimator: random paths from the root through the prepared LUTs,
+ * each path gives an unbiased estimate of visited nodes, XORs and solutions
+ */
+
+#ifndef _MRHS_ESTIMATE_H
+#define _MRHS_ESTIMATE_H
+
+#include "mrhs.bm.h"
+#include "mrhs.solver.h"
+
+/// results of the estimator: means of probes, half-widths of 95% confidence intervals
+typedef struct {
+    long long int probes;
+    double nodes, nodes_ci;     //visited nodes (Searched)
+    double xors, xors_ci;       //XORs counted by the search
+    double count, count_ci;     //solutions
+} SearchEstimate;
+
+/// estimates serial search of prepared system with weight bound max_weight
+/// probes until maxt seconds elapse or max_probes are done (max_probes <= 0: time only)
+/// random choices from rng
+/// returns number of probes
+long long int estimate_search(ActiveListEntry* ale, _bbm *pbbm, int max_weight, double maxt, long long int max_probes,
+                              _rng *rng, SearchEstimate *est);
+
+#endif //_MRHS_ESTIMATE_H
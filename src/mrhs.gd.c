@@ -0,0 +1,301 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * library file: guess-and-determine front end of RZ solver
+ *
+ * v1.8: guessed variables are substituted by linear_substitution,
+ *       remove_linear/remove_empty reduce the system, RZ solves the rest,
+ *       solutions are lifted by back substitution of removed linear equations
+ *
+ * Weight bound: RHS rows change by substitution (XOR constant of each block),
+ * RZ gets the constants (rhs_offset) to weight original rows, removed blocks
+ * have fixed weight
+ **********************************/
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "mrhs.bm.h"
+#include "mrhs.bv.h"
+#include "mrhs.h"
+#include "mrhs.rz.h"
+#include "mrhs.gd.h"
+
+static int bits(_block x)
+{
+    int result = 0;
+    for ( ; x; x &= x - 1)
+        result++;
+    return result;
+}
+
+static MRHS_system copy_system(MRHS_system *system)
+{
+    MRHS_system copy;
+    int *blocksizes = malloc(system->nblocks * sizeof(int));
+    int *rhscounts  = malloc(system->nblocks * sizeof(int));
+    int block;
+
+    for (block = 0; block < system->nblocks; block++)
+    {
+        blocksizes[block] = system->pM[block].ncols;
+        rhscounts[block]  = system->pS[block].nrows;
+    }
+    copy = create_mrhs_variable(system->pM[0].nrows, system->nblocks, blocksizes, rhscounts);
+    for (block = 0; block < system->nblocks; block++)
+    {
+        memcpy(copy.pM[block].rows, system->pM[block].rows, system->pM[block].nrows * sizeof(_block));
+        memcpy(copy.pS[block].rows, system->pS[block].rows, system->pS[block].nrows * sizeof(_block));
+    }
+    free(blocksizes);
+    free(rhscounts);
+    return copy;
+}
+
+//weight of x in system, -1 if x is not a solution
+static int check_solution(MRHS_system *system, _bv *x)
+{
+    int block, weight = 0;
+    _block value;
+
+    for (block = 0; block < system->nblocks; block++)
+    {
+        value = multiply_bv_x_bm(x, &system->pM[block]);
+        if (index_of_block_in_bm(&system->pS[block], value) < 0)
+            return -1;
+        weight += bits(value);
+    }
+    return weight;
+}
+
+/// chooses guess variables (rows of M) with most blocks, then most ones
+/// stores them to vars[guess], returns number of chosen variables
+int select_guess_vars(MRHS_system *system, int guess, int *vars)
+{
+    int nvars = system->pM[0].nrows;
+    int *blocks = calloc(nvars, sizeof(int));
+    int *ones   = calloc(nvars, sizeof(int));
+    char *used  = calloc(nvars, 1);
+    int block, row, i, best;
+
+    for (block = 0; block < system->nblocks; block++)
+        for (row = 0; row < nvars; row++)
+            if (system->pM[block].rows[row] != ZERO)
+            {
+                blocks[row]++;
+                ones[row] += bits(system->pM[block].rows[row]);
+            }
+
+    if (guess > nvars)
+        guess = nvars;
+    if (guess > GD_MAX_GUESS)
+        guess = GD_MAX_GUESS;
+
+    for (i = 0; i < guess; i++)
+    {
+        best = -1;
+        for (row = 0; row < nvars; row++)
+            if (!used[row] && (best < 0 || blocks[row] > blocks[best]
+                               || (blocks[row] == blocks[best] && ones[row] > ones[best])))
+                best = row;
+        used[best] = 1;
+        vars[i] = best;
+    }
+
+    free(blocks);
+    free(ones);
+    free(used);
+    return guess;
+}
+
+//lifting of solutions of one task back to the original system
+typedef struct {
+    MRHS_context *ctx;          //results of guess-and-determine
+    MRHS_system *system;        //original system
+    const int *vars;
+    int guess;
+    long long int assignment;
+    _bv *kept;                  //variables of the subsystem
+    MRHS_linear_log *log;       //removed linear equations
+    int weight;
+    long long int found;        //accepted solutions
+} GD_lift;
+
+//x: guessed values, solution y of the subsystem (NULL: no kept variables), back substitution
+//returns 1 and appends x to results if it solves the original system within weight
+static int lift_solution(GD_lift *lift, const _bv *y)
+{
+    int nvars = lift->system->pM[0].nrows;
+    int i, j, row, pivot, w;
+    _block value;
+    _bv x = create_bv(nvars);
+
+    for (i = 0; i < lift->guess; i++)
+        set_bit_bv(&x, lift->vars[i], (lift->assignment >> i) & ONE);
+    if (y != NULL)
+        for (row = 0, j = 0; row < nvars; row++)
+            if (get_bit_bv(lift->kept, row) == ONE)
+                set_bit_bv(&x, row, get_bit_bv(y, j++));
+
+    for (i = lift->log->count - 1; i >= 0; i--)
+    {
+        pivot = find_nonzero(&lift->log->columns[i], 0);
+        value = lift->log->rhs[i];
+        for (row = 0; row < nvars; row++)
+            if (row != pivot && get_bit_bv(&lift->log->columns[i], row) == ONE)
+                value ^= get_bit_bv(&x, row);
+        set_bit_bv(&x, pivot, value & ONE);
+    }
+
+    //inconsistent linear equations are not detected by substitution
+    w = check_solution(lift->system, &x);
+    if (w < 0 || w > lift->weight)
+    {
+        clear_bv(&x);
+        return 0;
+    }
+    x.weight = w;
+    add_result(lift->ctx, x);
+    lift->found++;
+    return 1;
+}
+
+//solution callback of RZ on the subsystem: search with abort stops at the first accepted solution
+static int lift_report(MRHS_context *subctx, const _bv *y, void *user)
+{
+    (void) subctx;
+    return !lift_solution((GD_lift*) user, y);
+}
+
+/// one task: vars[i] = bit i of assignment, RZ with weight, abort and opts (shard ignored)
+/// solutions are appended to ctx results, counters are added to ctx
+/// returns number of solutions of the task
+long long int solve_gd_task(MRHS_context *ctx, MRHS_system *system, const int *vars, int guess, long long int assignment,
+                            int weight, int abort, const RZ_options *opts)
+{
+    MRHS_system sub = copy_system(system);
+    MRHS_linear_log log = {0, NULL, NULL};
+    MRHS_context subctx;
+    RZ_options subopts;
+    GD_lift lift;
+    _bv unit, active, kept;
+    _block *offset;
+    int nvars = system->pM[0].nrows;
+    int block, i, fixed = 0, consistent = 1, nsub;
+    _block value;
+
+    //guessed values: x_v = bit of assignment
+    unit = create_bv(nvars);
+    for (i = 0; i < guess; i++)
+    {
+        set_one_bv(&unit, vars[i]);
+        linear_substitution(&sub, &unit, (assignment >> i) & ONE);
+        set_zero_bv(&unit, vars[i]);
+    }
+    clear_bv(&unit);
+    remove_linear_log(&sub, &log);
+
+    //constants added to RHS of each block, empty blocks: 0 must be in RHS, weight fixed
+    offset = calloc(sub.nblocks, sizeof(_block));
+    kept   = create_bv(nvars);
+    nsub   = 0;
+    for (block = 0; block < sub.nblocks; block++)
+    {
+        value  = (sub.pS[block].nrows > 0) ? sub.pS[block].rows[0] ^ system->pS[block].rows[0] : ZERO;
+        active = get_active_rows_bm(&sub.pM[block]);
+        if (is_non_zero_bv(&active))
+        {
+            or_bv(&kept, &active);
+            offset[nsub++] = value;
+        }
+        else
+        {
+            if (index_of_block_in_bm(&sub.pS[block], ZERO) < 0)
+                consistent = 0;
+            fixed += bits(value);
+        }
+        clear_bv(&active);
+    }
+    remove_empty(&sub);
+    init_context(&subctx, 0);
+
+    //lift: guessed values, kept variables from RZ, back substitution of linear equations
+    lift.ctx        = ctx;
+    lift.system     = system;
+    lift.vars       = vars;
+    lift.guess      = guess;
+    lift.assignment = assignment;
+    lift.kept       = &kept;
+    lift.log        = &log;
+    lift.weight     = weight;
+    lift.found      = 0;
+    subctx.report   = lift_report;
+    subctx.user     = &lift;
+
+    if (consistent && (weight == INT_MAX || fixed <= weight))
+    {
+        if (sub.nblocks > 0)
+        {
+            subopts = *opts;
+            subopts.shard      = 0;
+            subopts.shards     = 1;
+            subopts.checkpoint = NULL;
+            subopts.resume     = NULL;
+            subopts.rhs_offset = offset;
+            //abort: RZ solution may be rejected by check_solution, the callback stops the search
+            solve_rz(&subctx, &sub, weight == INT_MAX ? INT_MAX : weight - fixed, abort, &subopts);
+        }
+        else
+            lift_solution(&lift, NULL);     //all variables determined by linear equations
+    }
+
+    ctx->count += lift.found;
+    ctx->total += subctx.total;
+    ctx->xors  += subctx.xors;
+    clear_context(&subctx);
+    clear_bv(&kept);
+    free(offset);
+    clear_linear_log(&log);
+    clear_MRHS(&sub);
+    return lift.found;
+}
+
+/// guess-and-determine: same results as solve_rz, opts->shard/shards split the tasks
+long long int solve_gd(MRHS_context *ctx, MRHS_system *system, int guess, int weight, int abort, const RZ_options *opts)
+{
+    int vars[GD_MAX_GUESS];
+    long long int assignment, tasks;
+    RZ_options defaults;
+
+    clear_results(ctx);
+    if (opts == NULL)
+    {
+        default_rz_options(&defaults);
+        opts = &defaults;
+    }
+    if (system->nblocks == 0)
+        return 0;
+    if (opts->checkpoint != NULL || opts->resume != NULL)
+        fprintf(stderr, "Checkpoints are not supported with guessing, ignored\n");
+
+    guess = select_guess_vars(system, guess, vars);
+    tasks = 1ll << guess;
+#if (_VERBOSITY > 1)
+    fprintf(stdout, "Guess-and-determine: %lld tasks, variables", tasks);
+    for (int i = 0; i < guess; i++)
+        fprintf(stdout, " %d", vars[i]);
+    fprintf(stdout, "\n");
+#endif
+
+    //independent tasks, shard takes every shards-th
+    for (assignment = opts->shard; assignment < tasks; assignment += opts->shards)
+    {
+        solve_gd_task(ctx, system, vars, guess, assignment, weight, abort, opts);
+        if (abort == 1 && ctx->count > 0)
+            break;
+    }
+    return ctx->count;
+}
@@ -0,0 +1,34 @@
+/***
+ * MRHS solver: guess-and-determine front end of RZ solver
+ *
+ * g variables are guessed, each of 2^g assignments is an independent task:
+ * substitution, removal of linear and empty blocks, RZ on the smaller system,
+ * solutions are lifted back to all variables and checked in the original system
+ */
+
+#ifndef _MRHS_GD_H
+#define _MRHS_GD_H
+
+#include "mrhs.bm.h"
+#include "mrhs.h"
+#include "mrhs.rz.h"
+#include "mrhs.context.h"
+
+//max. number of guessed variables
+#define GD_MAX_GUESS 62
+
+/// chooses guess variables (rows of M) with most blocks, then most ones
+/// stores them to vars[guess], returns number of chosen variables
+int select_guess_vars(MRHS_system *system, int guess, int *vars);
+
+/// one task: vars[i] = bit i of assignment, RZ with weight, abort and opts (shard ignored)
+/// solutions are appended to ctx results, counters are added to ctx
+/// returns number of solutions of the task
+long long int solve_gd_task(MRHS_context *ctx, MRHS_system *system, const int *vars, int guess, long long int assignment,
+                            int weight, int abort, const RZ_options *opts);
+
+/// guess-and-determine: same results as solve_rz, opts->shard/shards split the tasks
+/// results and counters are stored to ctx (previous results are freed)
+long long int solve_gd(MRHS_context *ctx, MRHS_system *system, int guess, int weight, int abort, const RZ_options *opts);
+
+#endif //_MRHS_GD_H
@@ -33,13 +33,13 @@ void clear_MRHS(MRHS_system *system);
 
 /// Random systems
 
-void fill_mrhs_random(MRHS_system *psystem);
-void fill_mrhs_random_sparse(MRHS_system *psystem);
-void fill_mrhs_random_sparse_extra(MRHS_system *psystem, int density);
-void ensure_random_solution(MRHS_system *psystem);
+void fill_mrhs_random(MRHS_system *psystem, _rng *rng);
+void fill_mrhs_random_sparse(MRHS_system *psystem, _rng *rng);
+void fill_mrhs_random_sparse_extra(MRHS_system *psystem, int density, _rng *rng);
+void ensure_random_solution(MRHS_system *psystem, _rng *rng);
 
-void fill_mrhs_and(MRHS_system *psystem, int k, int l);
-void fill_mrhs_and_sparse(MRHS_system *psystem, int k, int l, int density);
+void fill_mrhs_and(MRHS_system *psystem, int k, int l, _rng *rng);
+void fill_mrhs_and_sparse(MRHS_system *psystem, int k, int l, int density, _rng *rng);
 
 /// I/O
 
@@ -48,10 +48,20 @@ int write_mrhs_variable(FILE *f, MRHS_system system);
 int print_mrhs(FILE *f, MRHS_system system);
 //int print_bbm(FILE* f, _bbm* system, char rhs);
 
+/// linear equations column*x = rhs in order of substitution
+typedef struct {
+	int count;
+	_bv *columns;
+	_block *rhs;
+} MRHS_linear_log;
+
 ///substitute given linear equation into system
 int linear_substitution(MRHS_system *system, _bv *column, _block rhs);
 ///remove linear equations from the system
 int remove_linear(MRHS_system *system);
+///remove linear equations from the system, substituted equations are appended to log (NULL: none)
+int remove_linear_log(MRHS_system *system, MRHS_linear_log *log);
+void clear_linear_log(MRHS_linear_log *log);
 int remove_empty(MRHS_system *system);
 
 #endif //_MRHS_H
@@ -197,9 +197,12 @@ int evaluate(_block rhs[], CompressedMRHS* cmrhs)
 #endif
 
 //PRE: pbbm and prhs are valid MRHS system
-long long int solve_hc(MRHS_system *system, _bv **pResults, int maxt, long long int* pCount, long long int* pRestarts)
+long long int solve_hc(MRHS_context *ctx, MRHS_system *system, int maxt)
 {
 	int retval;
+	_bv x;
+
+	clear_results(ctx);
 	if (system->nblocks == 0)
 		return 0;
 
@@ -220,7 +223,7 @@ long long int solve_hc(MRHS_system *system, _bv **pResults, int maxt, long long
 		memset(rhs, 0, cmrhs->nblocks * sizeof(_block));
 		for (int row = 0; row < nrows; row++)
 		{
-			solution[row] = rand() % 2;
+			solution[row] = next_rng(&ctx->rng) % 2;
 			if (solution[row] != 0)
 			{
 				add_row_hc(rhs, row, cmrhs);
@@ -268,8 +271,8 @@ long long int solve_hc(MRHS_system *system, _bv **pResults, int maxt, long long
 		}
 	}
 	//solution found?
-	*pCount    = count;
-	*pRestarts = restart;
+	ctx->xors  = count;
+	ctx->total = restart;
 
 
 	if (bestdiff == 0)
@@ -278,12 +281,12 @@ long long int solve_hc(MRHS_system *system, _bv **pResults, int maxt, long long
 		fprintf(stdout, "Solution found in %i restarts\n", restart);
 #endif
 
-		*pResults  = (_bv*) malloc(sizeof(_bv));
-		**pResults = create_bv(nrows);
+		x = create_bv(nrows);
 		for (int row = 0; row < nrows; row++)
 		{
-			set_bit_bv(*pResults, row, solution[row]);
+			set_bit_bv(&x, row, solution[row]);
 		}
+		add_result(ctx, x);
 
 		retval = 1;
 	}
@@ -297,6 +300,7 @@ long long int solve_hc(MRHS_system *system, _bv **pResults, int maxt, long long
 	free(rhs);
 	free(tmp);
 
+	ctx->count = retval;
 	return retval;
 }
 
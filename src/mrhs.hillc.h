@@ -11,8 +11,11 @@
 #include "mrhs.bm.h"
 #include "mrhs.bv.h"
 #include "mrhs.h"
+#include "mrhs.context.h"
 
 
-long long int solve_hc(MRHS_system *system, _bv **pResults, int maxt, long long int* pCount, long long int* pRestarts);
+/// random restarts from ctx->rng for maxt seconds, solution is stored to ctx
+/// ctx->xors: evaluations, ctx->total: restarts, returns number of solutions (0 or 1)
+long long int solve_hc(MRHS_context *ctx, MRHS_system *system, int maxt);
 
 #endif //_SOLVER_H
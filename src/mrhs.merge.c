@@ -0,0 +1,256 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * merge tool: combines outputs (-o OUT) of sharded RZ runs (--shard I/N)
+ *
+ * v1.8: checks that all parts solve the same system and cover all shards,
+ *       concatenates solutions, sums stats (split phase of the search counted once)
+ *
+ * Usage: mrhs-merge [-o OUT] FILE...
+ **********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//stats of one part, line "# shard I/N solutions C searched T xors X time S split T0 X0"
+// T0, X0: part above split depth, visited by every shard
+typedef struct {
+    int shard, shards;
+    long long int count, total, xors;
+    long long int split_total, split_xors;
+    double t;
+} _shard_stats;
+
+//growing list of lines
+typedef struct {
+    char **lines;
+    int count, size;
+} _lines;
+
+static void add_line(_lines *list, char *line)
+{
+    if (list->count == list->size)
+    {
+        list->size  = (list->size == 0) ? 64 : 2*list->size;
+        list->lines = (char**) realloc(list->lines, list->size * sizeof(char*));
+    }
+    list->lines[list->count++] = line;
+}
+
+static void clear_lines(_lines *list)
+{
+    int i;
+    for (i = 0; i < list->count; i++)
+        free(list->lines[i]);
+    free(list->lines);
+    list->lines = NULL;
+    list->count = list->size = 0;
+}
+
+//reads line of any length without the newline, NULL at the end of file
+static char* read_line(FILE *f)
+{
+    size_t len = 0, size = 256;
+    char *line = (char*) malloc(size);
+    int c;
+
+    while ((c = fgetc(f)) != EOF && c != '\n')
+    {
+        if (len + 1 == size)
+        {
+            size *= 2;
+            line = (char*) realloc(line, size);
+        }
+        line[len++] = (char) c;
+    }
+    if (c == EOF && len == 0)
+    {
+        free(line);
+        return NULL;
+    }
+    if (len > 0 && line[len-1] == '\r')
+        len--;
+    line[len] = '\0';
+    return line;
+}
+
+//system part: non-empty lines before solutions and stats
+static int same_system(_lines *a, _lines *b)
+{
+    int i;
+    if (a->count != b->count)
+        return 0;
+    for (i = 0; i < a->count; i++)
+        if (strcmp(a->lines[i], b->lines[i]) != 0)
+            return 0;
+    return 1;
+}
+
+static void help(char *fn)
+{
+    fprintf(stderr, "\nUsage: %s [-o OUT] FILE...\n", fn);
+    fprintf(stderr, "   FILE = output (-o OUT) of mrhs run with --shard I/N\n");
+    fprintf(stderr, "   OUT  = merged system, solutions and stats (def. stdout)\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+    _lines system = {NULL, 0, 0}, other = {NULL, 0, 0}, sols = {NULL, 0, 0}, solutions = {NULL, 0, 0};
+    _shard_stats part, sum;
+    char *line, *out = NULL;
+    char *seen = NULL;
+    FILE *f, *fout = stdout;
+    int arg, nparts = 0, errors = 0, found, ok, i;
+    double tmax = 0;
+
+    memset(&sum, 0, sizeof(sum));
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc)
+        {
+            out = argv[++arg];
+            continue;
+        }
+        if (argv[arg][0] == '-')
+        {
+            help(argv[0]);
+            return 1;
+        }
+
+        f = fopen(argv[arg], "r");
+        if (f == NULL)
+        {
+            fprintf(stderr, "Invalid file name: %s\n", argv[arg]);
+            return 2;
+        }
+
+        found = 0;
+        while ((line = read_line(f)) != NULL)
+        {
+            if (strncmp(line, "x ", 2) == 0)
+                add_line(&sols, line);
+            else if (strncmp(line, "# shard", 7) == 0)
+            {
+                part.split_total = part.split_xors = 0;
+                if (sscanf(line, "# shard %i/%i solutions %lld searched %lld xors %lld time %lf split %lld %lld",
+                           &part.shard, &part.shards, &part.count, &part.total, &part.xors, &part.t,
+                           &part.split_total, &part.split_xors) >= 6)
+                    found = 1;
+                free(line);
+            }
+            else if (line[0] == '\0')
+                free(line);
+            else
+                add_line(&other, line);
+        }
+        fclose(f);
+
+        //validate the part, rejected parts are not merged
+        if (!found)
+        {
+            fprintf(stderr, "%s: no shard stats (run with --shard I/N -o OUT)\n", argv[arg]);
+            ok = 0;
+        }
+        else if (nparts > 0 && !same_system(&system, &other))
+        {
+            fprintf(stderr, "%s: different system\n", argv[arg]);
+            ok = 0;
+        }
+        else if (part.shards < 1 || (nparts > 0 && part.shards != sum.shards)
+                 || part.shard < 0 || part.shard >= part.shards)
+        {
+            fprintf(stderr, "%s: shard %i/%i does not match %i shards\n", argv[arg], part.shard, part.shards, sum.shards);
+            ok = 0;
+        }
+        else if (nparts > 0 && seen[part.shard])
+        {
+            fprintf(stderr, "%s: shard %i/%i given twice\n", argv[arg], part.shard, part.shards);
+            ok = 0;
+        }
+        else if (nparts > 0 && (part.split_total != sum.split_total || part.split_xors != sum.split_xors))
+        {
+            fprintf(stderr, "%s: split phase differs from other shards\n", argv[arg]);
+            ok = 0;
+        }
+        else
+            ok = 1;
+
+        if (!ok)
+        {
+            errors++;
+            clear_lines(&other);
+            clear_lines(&sols);
+            continue;
+        }
+
+        if (nparts == 0)
+        {
+            system = other;     //first part: keep the system
+            memset(&other, 0, sizeof(other));
+            sum.shards = part.shards;
+            sum.split_total = part.split_total;
+            sum.split_xors  = part.split_xors;
+            seen = (char*) calloc(part.shards, 1);
+        }
+        clear_lines(&other);
+        seen[part.shard] = 1;
+
+        for (i = 0; i < sols.count; i++)
+            add_line(&solutions, sols.lines[i]);
+        free(sols.lines);
+        memset(&sols, 0, sizeof(sols));
+
+        nparts++;
+        sum.count += part.count;
+        sum.total += part.total;
+        sum.xors  += part.xors;
+        sum.t     += part.t;
+        if (part.t > tmax)
+            tmax = part.t;
+    }
+
+    if (nparts == 0)
+    {
+        help(argv[0]);
+        return 1;
+    }
+    for (i = 0; i < sum.shards; i++)
+        if (!seen[i])
+            fprintf(stderr, "Missing shard %i/%i, result is incomplete\n", i, sum.shards);
+
+    //split phase is searched by every shard, counted once
+    sum.total += sum.split_total;
+    sum.xors  += sum.split_xors;
+
+    if (out != NULL)
+    {
+        fout = fopen(out, "w");
+        if (fout == NULL)
+        {
+            fprintf(stderr, "Invalid file name: %s\n", out);
+            return 2;
+        }
+    }
+
+    //same layout as output of mrhs: system, solutions, stats
+    for (i = 0; i < system.count; i++)
+        fprintf(fout, "%s\n", system.lines[i]);
+    for (i = 0; i < solutions.count; i++)
+        fprintf(fout, "\n%s", solutions.lines[i]);
+    fprintf(fout, "\n# merged %i/%i solutions %lld searched %lld xors %lld time %.3lf max %.3lf\n",
+            nparts, sum.shards, sum.count, sum.total, sum.xors, sum.t, tmax);
+    if (fout != stdout)
+        fclose(fout);
+
+    fprintf(stderr, "Shards: %i/%i\nSolutions: %lld\nSearched %lld, XORs: %lld\nTime: %.3lf s total, %.3lf s max\n",
+            nparts, sum.shards, sum.count, sum.total, sum.xors, sum.t, tmax);
+
+    clear_lines(&system);
+    clear_lines(&solutions);
+    free(seen);
+
+    return (errors > 0 || nparts < sum.shards) ? 3 : 0;
+}
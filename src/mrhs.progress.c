@@ -0,0 +1,226 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * library file: progress report of RZ search
+ *
+ * v1.8: report from search monitor every few seconds,
+ *       done part of serial search from cursors of ale[], ETA by extrapolation
+ *
+ * Predicted nodes of level i: prod(|S_j|*2^(pj-lj) j=1 to i-1) * |S_i|*2^(pi-li),
+ * terms of get_expected, taken from the LUTs (lut_density): get_expected needs RHS sets,
+ * the search gets prepared LUTs only (RZ_batch frees the RHS sets after prepare)
+ *
+ * Time: monotonic wall clock with sub-second resolution (rates of short intervals)
+ **********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "mrhs.bm.h"
+#include "mrhs.solver.h"
+#include "mrhs.progress.h"
+
+//first entry of the bucket that contains entry i (i < entries of the LUT)
+static int bucket_begin(ActiveListEntry *ale, int i)
+{
+    int lo = 0, hi = ale->nbuckets, mid;
+
+    //last bucket with bucket[lo] <= i
+    while (hi - lo > 1)
+    {
+        mid = (lo + hi) / 2;
+        if (ale->bucket[mid] <= i)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+//done part of the tree of serial search, position of the top level in *pEntry/*pSize
+// levels below block: entry next-1 is in progress, level block: entries before next are done
+static double done_part(ActiveListEntry* ale, int block, int *pEntry, int *pSize)
+{
+    double done = 0, scale = 1;
+    int b, index, begin, size, entry;
+
+    *pEntry = *pSize = 0;
+    for (b = 0; b <= block; b++)
+    {
+        if (ale[b].next <= 0)
+            break;
+        index = bucket_begin(&ale[b], ale[b].next - 1);
+        begin = ale[b].bucket[index];
+        size  = ale[b].bucket[index + 1] - begin;
+        entry = ale[b].next - begin - (b < block ? 1 : 0);
+
+        if (b == 0)
+        {
+            *pEntry = entry;
+            *pSize  = size;
+        }
+        done  += scale * entry / size;
+        scale /= size;
+    }
+    return done;
+}
+
+//wall clock time in seconds
+static double wall_time(void)
+{
+#if defined(_OPENMP)
+    return omp_get_wtime();
+#elif defined(_WIN32)
+    LARGE_INTEGER counter, freq;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&freq);
+    return (double) counter.QuadPart / (double) freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+static void format_rate(char *buf, size_t size, double value)
+{
+    if (value >= 1e9)
+        snprintf(buf, size, "%.2lf G/s", value / 1e9);
+    else if (value >= 1e6)
+        snprintf(buf, size, "%.2lf M/s", value / 1e6);
+    else
+        snprintf(buf, size, "%.0lf /s", value);
+}
+
+static int progress_hook(SearchMonitor *monitor, ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                         long long int count, long long int total, long long int xors)
+{
+    ProgressState *ps = (ProgressState*) monitor->data;
+    double now, elapsed, span, done = -1;
+    int b, entry = 0, size = 0;
+    char line[256], nrate[32], xrate[32];
+    size_t len;
+
+    (void) weight;
+
+#ifdef _OPENMP
+#pragma omp critical (mrhs_progress)
+#endif
+    {
+        //counters since previous call of this search
+        ps->count += count;
+        ps->total += total;
+        ps->xors  += xors;
+        for (b = 0; b < pbbm->nblocks; b++)
+        {
+            ps->nodes[b] += ale[b].nodes;
+            ale[b].nodes = 0;
+        }
+
+        if (ps->serial && ps->start_done < 0)
+            ps->start_done = done_part(ale, block, &entry, &size);
+
+        now = wall_time();
+        if (now - ps->last >= ps->interval)
+        {
+            elapsed = now - ps->start;
+            span    = now - ps->last;
+            ps->last = now;
+
+            if (ps->serial)
+                done = done_part(ale, block, &entry, &size);
+            else if (ps->predicted > 0)
+                done = ps->total / ps->predicted;
+
+            //whole line at once, stdout may be interleaved
+            format_rate(nrate, sizeof(nrate), (ps->total - ps->last_total) / span);
+            format_rate(xrate, sizeof(xrate), (ps->xors - ps->last_xors) / span);
+            len = snprintf(line, sizeof(line), "Progress %.0lf s: nodes %lld (%s), XORs %lld (%s), solutions %lld",
+                           elapsed, ps->total, nrate, ps->xors, xrate, ps->count);
+            if (ps->serial && len < sizeof(line))
+                len += snprintf(line + len, sizeof(line) - len, ", block 0 entry %i/%i", entry, size);
+            if (done > 0 && done < 1 && done > ps->start_done && len < sizeof(line))
+                snprintf(line + len, sizeof(line) - len, ", done %.2lf%%, ETA %.0lf s%s", 100 * done,
+                         elapsed * (1 - done) / (done - ps->start_done), ps->serial ? "" : " (model)");
+            fprintf(stderr, "%s\n", line);
+
+            for (b = 0; b < ps->nblocks && (ps->nodes[b] > 0 || b <= block); b++)
+                fprintf(stderr, "  level %2i: nodes %lld, predicted %.0lf\n", b, ps->nodes[b], ps->expected[b]);
+
+            ps->last_total = ps->total;
+            ps->last_xors  = ps->xors;
+        }
+    }
+    return 0;
+}
+
+/// prepares progress report every interval seconds, sets up monitor for solve/solve_parallel
+/// threads > 1 or shards > 1: position is estimated from visited nodes only
+void init_progress(ProgressState *ps, SearchMonitor *monitor, ActiveListEntry* ale, _bbm *pbbm,
+                   int interval, int threads, int shards)
+{
+    int b;
+    double level;
+
+    ps->interval = (interval > 0) ? interval : 1;
+    ps->serial   = (threads <= 1 && shards <= 1);
+    ps->nblocks  = pbbm->nblocks;
+    ps->start    = ps->last = wall_time();
+    ps->count    = ps->total = ps->xors = 0;
+    ps->last_total = ps->last_xors = 0;
+    ps->start_done = ps->serial ? -1 : 0;
+    ps->nodes    = (long long int*) calloc(pbbm->nblocks, sizeof(long long int));
+    ps->expected = (double*) calloc(pbbm->nblocks, sizeof(double));
+
+    //root: bucket of index 0 of the first block, average bucket below
+    level = ale[0].bucket[LUT_BUCKET(&ale[0], 0) + 1] - ale[0].bucket[LUT_BUCKET(&ale[0], 0)];
+    ps->predicted = 0;
+    for (b = 0; b < pbbm->nblocks; b++)
+    {
+        if (b > 0)
+            level *= lut_density(ale, b);
+        ps->expected[b] = level;
+        ps->predicted  += level;
+    }
+    if (shards > 1)
+        ps->predicted /= shards;
+
+    monitor->interval = MONITOR_INTERVAL;
+    monitor->fn       = progress_hook;
+    monitor->data     = ps;
+    monitor->next     = NULL;
+}
+
+/// final report: nodes of each level in the whole search, counted since the last report are taken from ale[]
+void finish_progress(ProgressState *ps, ActiveListEntry* ale, _bbm *pbbm)
+{
+    int b, last = -1;
+
+    for (b = 0; b < pbbm->nblocks; b++)
+    {
+        ps->nodes[b] += ale[b].nodes;
+        ale[b].nodes = 0;
+        if (ps->nodes[b] > 0)
+            last = b;
+    }
+    fprintf(stderr, "Progress done:\n");
+    for (b = 0; b <= last; b++)
+        fprintf(stderr, "  level %2i: nodes %lld, predicted %.0lf\n", b, ps->nodes[b], ps->expected[b]);
+}
+
+/// cleanup
+void clear_progress(ProgressState *ps)
+{
+    free(ps->nodes);
+    free(ps->expected);
+    ps->nodes    = NULL;
+    ps->expected = NULL;
+}
@@ -0,0 +1,39 @@
+/***
+ * MRHS solver: progress report of RZ search
+ *
+ * Periodic report (stderr) from the search monitor: rates, position in the tree,
+ * nodes of each level compared with the model of get_expected, ETA
+ */
+
+#ifndef _MRHS_PROGRESS_H
+#define _MRHS_PROGRESS_H
+
+#include "mrhs.bm.h"
+#include "mrhs.solver.h"
+
+/// state of progress report, data of its monitor
+typedef struct {
+    int interval;           //seconds between reports
+    int serial;             //1: cursors of ale[] give position in the whole tree
+    int nblocks;
+    double start, last;     //wall clock time of start and of previous report, seconds
+    long long int count, total, xors;      //counters so far
+    long long int last_total, last_xors;   //counters at previous report
+    long long int *nodes;   //visited nodes of each level so far
+    double *expected;       //predicted nodes of each level (without weight bound)
+    double predicted;       //predicted nodes of the searched part
+    double start_done;      //done part at the first call (resumed search), -1 before
+} ProgressState;
+
+/// prepares progress report every interval seconds, sets up monitor for solve/solve_parallel
+/// threads > 1 or shards > 1: position is estimated from visited nodes only
+void init_progress(ProgressState *ps, SearchMonitor *monitor, ActiveListEntry* ale, _bbm *pbbm,
+                   int interval, int threads, int shards);
+
+/// final report: nodes of each level in the whole search (parallel search: merged from all workers)
+void finish_progress(ProgressState *ps, ActiveListEntry* ale, _bbm *pbbm);
+
+/// cleanup
+void clear_progress(ProgressState *ps);
+
+#endif //_MRHS_PROGRESS_H
@@ -0,0 +1,325 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * library file: block order
+ *
+ * v1.8: greedy/beam search of block order by predicted cost,
+ *       local search by adjacent swaps
+ *
+ * Pivots of each block are predicted by incremental column rank of M,
+ * cost is the Ntotal/Nxor formula from the article (see get_expected, get_xor1)
+ **********************************/
+
+#include <stdlib.h>
+#include <memory.h>
+#include <math.h>
+
+#include "mrhs.bm.h"
+#include "mrhs.h"
+#include "mrhs.reorder.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Cost model
+
+//columns of M as vectors over variables, sizes of RHS
+typedef struct {
+    int nblocks;
+    int nvars;
+    int words;        //words of one column vector
+    _block **cols;    //cols[block]: ncols vectors of words
+} OrderModel;
+
+//partial order with basis of columns used so far
+typedef struct {
+    int *order;
+    int len;
+    _block *basis;    //rank vectors of words, reduced in insertion order
+    int *pivot;       //pivot bit of each basis vector
+    int rank;
+    double cost;      //cost of blocks at positions [1, len)
+    double prod;      //prod |S_j|*2^(pj-lj), j < len
+} OrderState;
+
+//candidate extension of a state in beam search
+typedef struct {
+    int parent;
+    int block;
+    double cost, prod;
+    double key;
+} OrderCandidate;
+
+static void init_model(OrderModel *om, MRHS_system *system)
+{
+    int block, col, row;
+
+    om->nblocks = system->nblocks;
+    om->nvars   = system->pM[0].nrows;
+    om->words   = GET_NUM_BLOCKS(om->nvars);
+    om->cols    = (_block**) calloc(om->nblocks, sizeof(_block*));
+
+    for (block = 0; block < om->nblocks; block++)
+    {
+        om->cols[block] = (_block*) calloc((size_t) system->pM[block].ncols * om->words, sizeof(_block));
+        for (col = 0; col < system->pM[block].ncols; col++)
+            for (row = 0; row < om->nvars; row++)
+                if ((system->pM[block].rows[row] >> col) & ONE)
+                    om->cols[block][col * om->words + row / MAXBLOCKSIZE] |= ONE << (row % MAXBLOCKSIZE);
+    }
+}
+
+static void clear_model(OrderModel *om)
+{
+    int block;
+    for (block = 0; block < om->nblocks; block++)
+        free(om->cols[block]);
+    free(om->cols);
+}
+
+static void init_state(OrderState *state, OrderModel *om)
+{
+    state->order = (int*) calloc(om->nblocks, sizeof(int));
+    state->basis = (_block*) calloc((size_t) (om->nvars + 1) * om->words, sizeof(_block));
+    state->pivot = (int*) calloc(om->nvars + 1, sizeof(int));
+    state->len   = 0;
+    state->rank  = 0;
+    state->cost  = 0;
+    state->prod  = 1;
+}
+
+static void clear_state(OrderState *state)
+{
+    free(state->order);
+    free(state->basis);
+    free(state->pivot);
+}
+
+static void copy_state(OrderState *dst, OrderState *src, OrderModel *om)
+{
+    memcpy(dst->order, src->order, src->len * sizeof(int));
+    memcpy(dst->basis, src->basis, (size_t) src->rank * om->words * sizeof(_block));
+    memcpy(dst->pivot, src->pivot, src->rank * sizeof(int));
+    dst->len  = src->len;
+    dst->rank = src->rank;
+    dst->cost = src->cost;
+    dst->prod = src->prod;
+}
+
+//adds columns of block to the basis of state, returns number of new pivots
+// basis vectors above the original rank are overwritten, rank can be restored by caller
+static int add_block(OrderState *state, OrderModel *om, MRHS_system *system, int block)
+{
+    int col, i, w, rank = state->rank;
+    _block *v;
+
+    for (col = 0; col < system->pM[block].ncols; col++)
+    {
+        v = state->basis + (size_t) state->rank * om->words;
+        memcpy(v, om->cols[block] + (size_t) col * om->words, om->words * sizeof(_block));
+
+        for (i = 0; i < state->rank; i++)
+            if ((v[state->pivot[i] / MAXBLOCKSIZE] >> (state->pivot[i] % MAXBLOCKSIZE)) & ONE)
+                for (w = 0; w < om->words; w++)
+                    v[w] ^= state->basis[(size_t) i * om->words + w];
+
+        //lowest non-zero bit becomes pivot
+        for (w = 0; w < om->words; w++)
+            if (v[w] != 0)
+                break;
+        if (w == om->words)
+            continue;   //dependent column
+
+        for (i = 0; ((v[w] >> i) & ONE) == 0; i++)
+            ;
+        state->pivot[state->rank++] = w * MAXBLOCKSIZE + i;
+    }
+    return state->rank - rank;
+}
+
+//cost and prod after block with given pivots is placed at position len
+static void extend_cost(MRHS_system *system, int nblocks, int len, int block, int pivots,
+                        int cost, double *pCost, double *pProd)
+{
+    double weight = 1;
+    int l = system->pM[block].ncols;
+
+    if (cost == ORDER_NXOR)
+        weight = ceil((nblocks - len) * l / (double) MAXBLOCKSIZE);
+
+    //first block: only factor of the product
+    if (len > 0)
+        *pCost += weight * (*pProd);
+    *pProd *= ldexp(system->pS[block].nrows, pivots - l);
+}
+
+static double order_cost(OrderModel *om, MRHS_system *system, const int *order, int cost)
+{
+    OrderState state;
+    int i, block, pivots;
+    double result;
+
+    init_state(&state, om);
+    for (i = 0; i < om->nblocks; i++)
+    {
+        block  = (order == NULL) ? i : order[i];
+        pivots = add_block(&state, om, system, block);
+        extend_cost(system, om->nblocks, i, block, pivots, cost, &state.cost, &state.prod);
+    }
+    result = state.cost;
+    clear_state(&state);
+    return result;
+}
+
+/// predicted cost of RZ search with blocks in given order
+/// order == NULL: input order
+double get_order_cost(MRHS_system *system, const int *order, int cost)
+{
+    OrderModel om;
+    double result;
+
+    if (system->nblocks == 0)
+        return 0;
+
+    init_model(&om, system);
+    result = order_cost(&om, system, order, cost);
+    clear_model(&om);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Search
+
+//ascending key, ties broken by parent and block (deterministic result)
+static int compare_candidates(const void *a, const void *b)
+{
+    const OrderCandidate *ca = (const OrderCandidate*) a;
+    const OrderCandidate *cb = (const OrderCandidate*) b;
+
+    if (ca->key != cb->key)
+        return (ca->key < cb->key) ? -1 : 1;
+    if (ca->parent != cb->parent)
+        return ca->parent - cb->parent;
+    return ca->block - cb->block;
+}
+
+/// finds block order with low predicted cost, stores it in order[nblocks]
+/// beam = 1: greedy, beam > 1: beam search of given width
+/// swaps: max. number of passes of adjacent swaps (local search)
+/// returns predicted cost of the order
+double find_block_order(MRHS_system *system, int *order, int beam, int swaps, int cost)
+{
+    OrderModel om;
+    OrderState *cur, *nxt, *tmp;
+    OrderCandidate *cand;
+    int ncur, ncand, i, j, block, pivots, rank, pass, improved;
+    char *used;
+    double best, value;
+
+    if (system->nblocks == 0)
+        return 0;
+    if (beam < 1)
+        beam = 1;
+
+    init_model(&om, system);
+
+    cur  = (OrderState*) calloc(beam, sizeof(OrderState));
+    nxt  = (OrderState*) calloc(beam, sizeof(OrderState));
+    for (i = 0; i < beam; i++)
+    {
+        init_state(&cur[i], &om);
+        init_state(&nxt[i], &om);
+    }
+    cand = (OrderCandidate*) malloc((size_t) beam * om.nblocks * sizeof(OrderCandidate));
+    used = (char*) malloc(om.nblocks);
+
+    //beam search: extend each partial order by each unused block, keep best
+    ncur = 1;
+    while (cur[0].len < om.nblocks)
+    {
+        ncand = 0;
+        for (i = 0; i < ncur; i++)
+        {
+            memset(used, 0, om.nblocks);
+            for (j = 0; j < cur[i].len; j++)
+                used[cur[i].order[j]] = 1;
+
+            for (block = 0; block < om.nblocks; block++)
+            {
+                if (used[block])
+                    continue;
+
+                rank   = cur[i].rank;
+                pivots = add_block(&cur[i], &om, system, block);
+                cur[i].rank = rank;
+
+                cand[ncand].parent = i;
+                cand[ncand].block  = block;
+                cand[ncand].cost   = cur[i].cost;
+                cand[ncand].prod   = cur[i].prod;
+                extend_cost(system, om.nblocks, cur[i].len, block, pivots, cost,
+                            &cand[ncand].cost, &cand[ncand].prod);
+                //partial cost + next term of the sum
+                cand[ncand].key = cand[ncand].cost + cand[ncand].prod;
+                ncand++;
+            }
+        }
+
+        qsort(cand, ncand, sizeof(OrderCandidate), compare_candidates);
+        if (ncand > beam)
+            ncand = beam;
+
+        for (i = 0; i < ncand; i++)
+        {
+            copy_state(&nxt[i], &cur[cand[i].parent], &om);
+            add_block(&nxt[i], &om, system, cand[i].block);
+            nxt[i].order[nxt[i].len++] = cand[i].block;
+            nxt[i].cost = cand[i].cost;
+            nxt[i].prod = cand[i].prod;
+        }
+        ncur = ncand;
+        tmp = cur; cur = nxt; nxt = tmp;
+    }
+
+    //best complete order
+    j = 0;
+    for (i = 1; i < ncur; i++)
+        if (cur[i].cost < cur[j].cost)
+            j = i;
+    memcpy(order, cur[j].order, om.nblocks * sizeof(int));
+    best = cur[j].cost;
+
+    //local search: adjacent swaps while it helps
+    for (pass = 0; pass < swaps; pass++)
+    {
+        improved = 0;
+        for (i = 0; i + 1 < om.nblocks; i++)
+        {
+            block = order[i]; order[i] = order[i+1]; order[i+1] = block;
+            value = order_cost(&om, system, order, cost);
+            if (value < best)
+            {
+                best = value;
+                improved = 1;
+            }
+            else
+            {
+                block = order[i]; order[i] = order[i+1]; order[i+1] = block;
+            }
+        }
+        if (!improved)
+            break;
+    }
+
+    for (i = 0; i < beam; i++)
+    {
+        clear_state(&cur[i]);
+        clear_state(&nxt[i]);
+    }
+    free(cur);
+    free(nxt);
+    free(cand);
+    free(used);
+    clear_model(&om);
+
+    return best;
+}
@@ -0,0 +1,29 @@
+/***
+ * MRHS solver: block order
+ * See: Håvard Raddum and Pavol Zajac MRHS Solver Based on Linear Algebra and Exhaustive Search
+ *
+ * RZ search cost depends on the order of blocks, order is chosen
+ * from the cost formulas of the article (Ntotal, Nxor), before echelonize
+ */
+
+#ifndef _MRHS_REORDER_H
+#define _MRHS_REORDER_H
+
+#include "mrhs.bm.h"
+#include "mrhs.h"
+
+//objective of reordering
+#define ORDER_NTOTAL    0   //predicted number of lookups
+#define ORDER_NXOR      1   //predicted number of xors
+
+/// predicted cost of RZ search with blocks in given order
+/// order == NULL: input order
+double get_order_cost(MRHS_system *system, const int *order, int cost);
+
+/// finds block order with low predicted cost, stores it in order[nblocks]
+/// beam = 1: greedy, beam > 1: beam search of given width
+/// swaps: max. number of passes of adjacent swaps (local search)
+/// returns predicted cost of the order
+double find_block_order(MRHS_system *system, int *order, int beam, int swaps, int cost);
+
+#endif //_MRHS_REORDER_H
@@ -24,54 +24,35 @@
 #include "mrhs.bv.h"
 #include "mrhs.h"
 #include "mrhs.hillc.h"
+#include "mrhs.rz.h"
+#include "mrhs.simd.h"
 #include "mrhs.solver.h"
+#include "mrhs.checkpoint.h"
+#include "mrhs.progress.h"
+#include "mrhs.context.h"
 
 
-_bbm *GlobalA = NULL;
-_bv  *GlobalResults = NULL;
-
-//TODO: create function in solver to get solution y, and to multiply y*A
-int report_solution_extract_y(long long int counter, _bbm *pbbm, ActiveListEntry* ale, int weight)
+//solution x from x_rows of entries on the path (see prepare_x), data: MRHS_context
+int report_solution_extract_y(long long int counter, _bbm *pbbm, ActiveListEntry* ale, int weight, void *data)
 {
-     int block, pivot, i;
-     _block value, *y = malloc(pbbm->nrows * sizeof(_block));
-
+     _bv x = create_bv(pbbm->nrows);
 #if (_VERBOSITY > 1)
+     int block;
 	 fprintf(stdout, "Found solution %lli: ", counter);
+#else
+     (void) counter;    //results are appended to the context
 #endif
 
-     GlobalResults = (_bv*) realloc(GlobalResults, counter*(sizeof(_bv)));
-     GlobalResults[counter-1] = create_bv(GlobalA->nblocks);
-     GlobalResults[counter - 1].weight = weight;
-
-     //TODO: create better functions for this...
-     i = 0;
-     for (block = 0; block < pbbm->nblocks; block++)
-     {
-         value = ale[block].val;
-         value>>=(pbbm->blocksizes[block]-pbbm->pivots[block]);
-         for (pivot = 0; pivot < pbbm->pivots[block]; pivot++, value>>=1)
-         {
-             y[i++] = value&ONE;
-         }
-     }
-
-     for (block = 0; block < GlobalA->nblocks; block++)
-     {
-         value = 0;
-         for (i = 0; i < GlobalA->nrows; i++)
-         {
-            value ^= y[i] & GlobalA->rows[i][block];
-         }
-         set_bit_bv(&GlobalResults[counter-1], block, value&ONE);
-#if (_VERBOSITY > 1)
-		fprintf(stdout, "%01x", (unsigned) (value&ONE));
-#endif
-     }
+     x.weight = weight;
+     get_solution_x(ale, pbbm, x.row);
+
 #if (_VERBOSITY > 1)
+     for (block = 0; block < pbbm->nrows; block++)
+		fprintf(stdout, "%01x", (unsigned) get_bit_bv(&x, block));
 	 fprintf(stdout, "\n");
 #endif
-	return 0;   //return 1; to find multiple solutions
+	//callback of the context decides, without it: return 0, stop with abort
+	return add_result((MRHS_context*) data, x);
 }
 
 int hamming_weight(_block input) {
@@ -85,76 +66,500 @@ int hamming_weight(_block input) {
     return result;
 }
 
-//front end to non-recursive call
-//TODO: connect with MRHS RZ solver, refactor...
-long long int solve_rz(MRHS_system *system, _bv **pResults, int maxt, int weight, int abort, long long int* pTotal, long long int* pXors)
+/// default settings: serial search
+void default_rz_options(RZ_options *opts)
 {
-    //_experiment easd;
-     ActiveListEntry* pActiveList;
-     long long int count = 0;
-
-    _bbm *pbbm, **prhs, *pA = NULL;
+    opts->threads = 1;
+    opts->depth   = -1;
+    opts->reorder = 0;
+    opts->swaps   = 0;
+    opts->cost    = ORDER_NTOTAL;
+    opts->checkpoint = NULL;
+    opts->checkpoint_interval = CHECKPOINT_INTERVAL;
+    opts->resume     = NULL;
+    opts->shard      = 0;
+    opts->shards     = 1;
+    opts->progress   = 0;
+    opts->rhs_offset = NULL;
+    opts->lut_budget = LUT_BUDGET;
+    opts->lazy       = 0;
+    opts->share      = 0;
+}
 
-    if (system->nblocks == 0)
+//block order from opts: variables are not permuted, so solutions x are not affected
+static int* get_rz_order(MRHS_system *system, const RZ_options *opts)
+{
+    int *order = malloc(system->nblocks * sizeof(int));
+    if (opts->reorder > 0)
     {
-        return 0;
+#if (_VERBOSITY > 1)
+        double before = get_order_cost(system, NULL, opts->cost);
+#endif
+#if (_VERBOSITY > 1)
+        double after =
+#endif
+        find_block_order(system, order, opts->reorder, opts->swaps, opts->cost);
+#if (_VERBOSITY > 1)
+        fprintf(stdout, "Block order: predicted %s %.0lf -> %.0lf\n",
+                opts->cost == ORDER_NXOR ? "Nxor" : "Ntotal", before, after);
+#endif
+    }
+    else
+    {
+        for (int block = 0; block < system->nblocks; block++)
+            order[block] = block;
     }
+    return order;
+}
+
+//matrix M of system in block order
+static _bbm* build_rz_matrix(MRHS_system *system, const int *order)
+{
+    _bbm *pbbm;
 
 	//TODO: pbbm and prhs from system...
 	int *blocksizes = malloc(system->nblocks * sizeof(int));
 	for (int block = 0; block < system->nblocks; block++)
-		blocksizes[block] = system->pM[block].ncols;
+		blocksizes[block] = system->pM[order[block]].ncols;
 
     pbbm = create_bbm_new(system->pM[0].nrows, system->nblocks, blocksizes);
+    free(blocksizes);
     for (int block = 0; block < system->nblocks; block++)
     {
 		for (int row = 0; row < pbbm->nrows; row++)
 		{
-			pbbm->rows[row][block] = system->pM[block].rows[row];
+			pbbm->rows[row][block] = system->pM[order[block]].rows[row];
 		}
 	}
+    return pbbm;
+}
 
-    prhs = (_bbm**) calloc(pbbm->nblocks, sizeof(_bbm*));
-    for (int block = 0; block < pbbm->nblocks; block++)
+//RHS of system block order[block], weights of rows (with opts->rhs_offset)
+static _bbm* build_rz_rhs_block(MRHS_system *system, const int *order, int block, const RZ_options *opts)
+{
+    _bm *pS = &system->pS[order[block]];
+    _bbm *prhs = create_bbm(pS->nrows, 1, pS->ncols);
+    for (int row = 0; row < prhs->nrows; row++)
     {
-        prhs[block] = create_bbm(system->pS[block].nrows, 1, system->pS[0].ncols);
-        for (int row = 0; row < prhs[block]->nrows; row++)
-        {
-			prhs[block]->rows[row][0] = system->pS[block].rows[row];
-            prhs[block]->weights[row] = hamming_weight(system->pS[block].rows[row]);
-		}
-	}
+        prhs->rows[row][0] = pS->rows[row];
+        prhs->weights[row] = hamming_weight(pS->rows[row]
+                               ^ (opts->rhs_offset != NULL ? opts->rhs_offset[order[block]] : 0));
+    }
+    return prhs;
+}
 
-//#if (_VERBOSITY > 1)
-    int rank =
-//#endif
-                echelonize(pbbm, prhs, &pA);
+//RHSs of system in block order, weights of rows (with opts->rhs_offset)
+static _bbm** build_rz_rhs(MRHS_system *system, const int *order, const RZ_options *opts)
+{
+    _bbm **prhs = (_bbm**) calloc(system->nblocks, sizeof(_bbm*));
+    for (int block = 0; block < system->nblocks; block++)
+        prhs[block] = build_rz_rhs_block(system, order, block, opts);
+    return prhs;
+}
 
+static void free_rz_rhs(_bbm **prhs, int nblocks)
+{
+    for (int block = 0; block < nblocks; block++)
+        if (prhs[block] != NULL)
+            free_bbm(prhs[block]);
+    free(prhs);
+}
 
-    //print_bbm(stdout, pbbm, 0);
-    //print_bbm(stdout, prhs, 1);
-    GlobalA = pA;
-#if (_VERBOSITY > 1)
-	fprintf(stdout, "Starting RZ solver, system rank = %i\n", rank);
-#endif
-    pActiveList = prepare(pbbm, prhs);
+//matrix and RHSs of system in block order from opts, echelonized
+// returns rank, *ppA: transformation for extracting solutions
+static int build_rz(MRHS_system *system, const RZ_options *opts, _bbm **ppbbm, _bbm ***pprhs, _bbm **ppA)
+{
+    int *order = get_rz_order(system, opts);
 
-    *pTotal = solve(pActiveList, pbbm, &count, pXors, weight, abort, report_solution_extract_y);
+    *ppbbm = build_rz_matrix(system, order);
+    *pprhs = build_rz_rhs(system, order, opts);
+    free(order);
 
-    free_ales(pActiveList, pbbm->nblocks);
+    *ppA   = NULL;
+    return echelonize(*ppbbm, *pprhs, ppA);
+}
 
+static void clear_rz(_bbm *pbbm, _bbm **prhs, _bbm *pA)
+{
     if (pA != NULL)
         free_bbm(pA);
-    for (int block = 0; block < pbbm->nblocks; block++)
-        free_bbm(prhs[block]);
-    free(prhs);
+    free_rz_rhs(prhs, pbbm->nblocks);
     free_bbm(pbbm);
+}
+
+#if (_VERBOSITY > 1)
+//representation of LUT of each block (see prepare), blocks in search order
+static void report_luts(ActiveListEntry* pActiveList, _bbm *pbbm)
+{
+    int block, sorted = 0;
+
+    if (pActiveList[0].lazy != NULL)
+    {
+        fprintf(stdout, "LUTs: built on first visit\n");
+        return;
+    }
+    for (block = 0; block < pbbm->nblocks; block++)
+        sorted += (pActiveList[block].keys != NULL);
+    fprintf(stdout, "LUTs: %i dense, %i sorted", pbbm->nblocks - sorted, sorted);
+    if (shared_luts(pActiveList) > 0)
+        fprintf(stdout, ", %i distinct by sharing", shared_luts(pActiveList));
+    for (block = 0; block < pbbm->nblocks; block++)
+        if (pActiveList[block].keys != NULL)
+            fprintf(stdout, ", block %i: %i of 2^%i", block, pActiveList[block].nbuckets,
+                    pbbm->blocksizes[block] - pbbm->pivots[block]);
+    fprintf(stdout, "\n");
+}
 
-    *pResults = GlobalResults;
+//lazy prepare: LUTs built by the search
+static void report_built_luts(ActiveListEntry* pActiveList, _bbm *pbbm)
+{
+    int block, built = 0;
+
+    if (pActiveList[0].lazy == NULL)
+        return;
+    for (block = 0; block < pbbm->nblocks; block++)
+        built += (pActiveList[block].bucket != NULL);
+    fprintf(stdout, "LUTs built: %i of %i\n", built, pbbm->nblocks);
+}
+#endif
+
+//search of echelonized system with LUTs (prepare, prepare_x) by opts, counters to ctx
+// returns number of solutions, -1 if resume failed
+static long long int search_rz(MRHS_context *ctx, _bbm *pbbm, ActiveListEntry* pActiveList, int weight, int abort,
+                               const RZ_options *opts)
+{
+     long long int count = 0;
+     ProgressState progress;
+     SearchMonitor monitor, *pMonitor = NULL;
 
 #if (_VERBOSITY > 1)
+	fprintf(stdout, "Starting RZ solver, system rank = %i, XOR kernel: %s\n", ctx->rank, init_xor_rows());
+#else
+    init_xor_rows();
+#endif
+#if (_VERBOSITY > 1)
+    //checkpoints and progress report use monitors, parallel search a pool
+	fprintf(stdout, "Search kernel: %s\n", get_kernel_name(pActiveList, pbbm, weight,
+            opts->progress > 0 || opts->checkpoint != NULL || opts->resume != NULL || opts->threads > 1 || opts->shards > 1));
+    report_luts(pActiveList, pbbm);
+#endif
+
+    if (opts->progress > 0)
+    {
+        //checkpoints: serial search of the whole tree
+        int serial = (opts->checkpoint != NULL || opts->resume != NULL) && opts->shards <= 1;
+        init_progress(&progress, &monitor, pActiveList, pbbm, opts->progress,
+                      serial ? 1 : opts->threads, opts->shards);
+        pMonitor = &monitor;
+    }
+
+    if ((opts->checkpoint != NULL || opts->resume != NULL) && opts->shards > 1)
+        fprintf(stderr, "Checkpoints are not supported with shards, ignored\n");
+
+    if ((opts->checkpoint != NULL || opts->resume != NULL) && opts->shards <= 1)
+    {
+        if (opts->threads > 1)
+            fprintf(stderr, "Checkpoints require serial search, using 1 thread\n");
+        ctx->total = solve_checkpoint(pActiveList, pbbm, &count, &ctx->xors, weight, abort, report_solution_extract_y, ctx,
+                                      opts->checkpoint, opts->checkpoint_interval, opts->resume, pMonitor);
+        if (ctx->total < 0)
+        {
+            ctx->total = 0;
+            count = -1;     //resume failed
+        }
+    }
+    else if (opts->threads > 1 || opts->shards > 1)
+        ctx->total = solve_parallel(pActiveList, pbbm, &count, &ctx->xors, weight, abort, report_solution_extract_y, ctx,
+                                    opts->threads, opts->depth, opts->shard, opts->shards, pMonitor, &ctx->split, &ctx->split_xors);
+    else
+        ctx->total = solve(pActiveList, pbbm, &count, &ctx->xors, weight, abort, report_solution_extract_y, ctx, pMonitor);
+    ctx->count = count;
+
+    if (pMonitor != NULL)
+    {
+        finish_progress(&progress, pActiveList, pbbm);
+        clear_progress(&progress);
+    }
+
+#if (_VERBOSITY > 1)
+    report_built_luts(pActiveList, pbbm);
 	fprintf(stdout, "RZ done\n");
 #endif
+    return count;
+}
+
+//front end to non-recursive call
+//TODO: connect with MRHS RZ solver, refactor...
+long long int solve_rz(MRHS_context *ctx, MRHS_system *system, int weight, int abort, const RZ_options *opts)
+{
+    //_experiment easd;
+     long long int count = 0;
+     RZ_options defaults;
+
+    if (opts == NULL)
+    {
+        default_rz_options(&defaults);
+        opts = &defaults;
+    }
+
+    _bbm *pbbm, **prhs, *pA = NULL;
+    ActiveListEntry* pActiveList;
+
+    clear_results(ctx);
+
+    if (system->nblocks == 0)
+    {
+        return 0;
+    }
+
+    ctx->rank = build_rz(system, opts, &pbbm, &prhs, &pA);
+    ctx->A    = pA;
+
+    //print_bbm(stdout, pbbm, 0);
+    //print_bbm(stdout, prhs, 1);
+    if (opts->lazy && (opts->checkpoint != NULL || opts->resume != NULL) && opts->shards <= 1)
+        fprintf(stderr, "Checkpoints hash all lookup tables, lazy prepare ignored\n");
+    else if (opts->lazy && opts->share)
+        fprintf(stderr, "Shared lookup tables are built at once, lazy prepare ignored\n");
+    if (opts->lazy && !opts->share && !((opts->checkpoint != NULL || opts->resume != NULL) && opts->shards <= 1))
+        pActiveList = prepare_lazy(pbbm, prhs, pA, (size_t) opts->lut_budget);
+    else
+    {
+        if (opts->share)
+            pActiveList = prepare_shared(pbbm, prhs, (size_t) opts->lut_budget);
+        else
+            pActiveList = prepare(pbbm, prhs, (size_t) opts->lut_budget);
+        prepare_x(pActiveList, pbbm, pA);
+    }
+    count = search_rz(ctx, pbbm, pActiveList, weight, abort, opts);
+    free_ales(pActiveList, pbbm->nblocks);
+
+    //transform stays in the context
+    clear_rz(pbbm, prhs, NULL);
 
    	return count;
 }
+
+/// prepares M of system for solving with many RHSs: block order, echelon form,
+/// column transform of each block (opts->reorder, swaps, cost are used), returns rank
+int prepare_rz_batch(RZ_batch *batch, MRHS_system *system, const RZ_options *opts)
+{
+    RZ_options defaults;
+    _bbm **probe;
+    int block, j;
+
+    if (opts == NULL)
+    {
+        default_rz_options(&defaults);
+        opts = &defaults;
+    }
+
+    batch->nblocks = system->nblocks;
+    batch->nrows   = (system->nblocks > 0) ? system->pM[0].nrows : 0;
+    batch->rank    = 0;
+    batch->order   = NULL;
+    batch->pbbm    = NULL;
+    batch->pA      = NULL;
+    batch->images  = NULL;
+    batch->ale     = NULL;
+    if (system->nblocks == 0)
+        return 0;
+
+    //blocks of a batch are rebuilt one by one (update_ales)
+    if (opts->share)
+        fprintf(stderr, "Shared lookup tables are not supported in batches, ignored\n");
+    batch->order = get_rz_order(system, opts);
+    batch->pbbm  = build_rz_matrix(system, batch->order);
+
+    //echelonize transforms RHS by column operations only: unit vectors give the transform
+    probe = (_bbm**) calloc(system->nblocks, sizeof(_bbm*));
+    for (block = 0; block < system->nblocks; block++)
+    {
+        probe[block] = create_bbm(batch->pbbm->blocksizes[block], 1, batch->pbbm->blocksizes[block]);
+        for (j = 0; j < probe[block]->nrows; j++)
+            probe[block]->rows[j][0] = ONE << j;
+    }
+    batch->rank = echelonize(batch->pbbm, probe, &batch->pA);
+
+    batch->images = (_block**) calloc(system->nblocks, sizeof(_block*));
+    for (block = 0; block < system->nblocks; block++)
+    {
+        batch->images[block] = (_block*) malloc(probe[block]->nrows * sizeof(_block));
+        for (j = 0; j < probe[block]->nrows; j++)
+            batch->images[block][j] = probe[block]->rows[j][0];
+    }
+    free_rz_rhs(probe, system->nblocks);
+
+    return batch->rank;
+}
+
+//RHS of batch block with the column transform of echelonize
+static void transform_rz_rhs(RZ_batch *batch, int block, _bbm *prhs)
+{
+    _block value, image;
+    int row, j;
+
+    for (row = 0; row < prhs->nrows; row++)
+    {
+        image = ZERO;
+        for (value = prhs->rows[row][0], j = 0; value; value >>= 1, j++)
+            if (value & ONE)
+                image ^= batch->images[block][j];
+        prhs->rows[row][0] = image;
+    }
+}
+
+/// solves system with M of the batch (only RHSs of system are used) as solve_rz
+/// LUTs stay in the batch for update_rz_batch
+/// PRE: system has the same M as the system of prepare_rz_batch
+long long int solve_rz_batch(MRHS_context *ctx, RZ_batch *batch, MRHS_system *system, int weight, int abort,
+                             const RZ_options *opts)
+{
+    RZ_options defaults;
+    _bbm **prhs;
+    int block;
+
+    if (opts == NULL)
+    {
+        default_rz_options(&defaults);
+        opts = &defaults;
+    }
+
+    clear_results(ctx);
+    if (batch->nblocks == 0)
+        return 0;
+
+    //RHSs with the column transform of echelonize
+    prhs = build_rz_rhs(system, batch->order, opts);
+    for (block = 0; block < batch->nblocks; block++)
+        transform_rz_rhs(batch, block, prhs[block]);
+
+    if (batch->ale != NULL)
+        free_ales(batch->ale, batch->nblocks);
+    batch->ale = prepare(batch->pbbm, prhs, (size_t) opts->lut_budget);
+    prepare_x(batch->ale, batch->pbbm, batch->pA);
+    free_rz_rhs(prhs, batch->nblocks);
+
+    //transform belongs to the batch
+    ctx->rank = batch->rank;
+    return search_rz(ctx, batch->pbbm, batch->ale, weight, abort, opts);
+}
+
+/// solves system as solve_rz_batch, only LUTs of nchanged blocks (system block indices in blocks)
+/// are rebuilt, other blocks keep RHSs of the last solved system
+/// PRE: same opts as the last solve_rz_batch/update_rz_batch, RHSs of other blocks are unchanged
+long long int update_rz_batch(MRHS_context *ctx, RZ_batch *batch, MRHS_system *system, const int *blocks, int nchanged,
+                              int weight, int abort, const RZ_options *opts)
+{
+    RZ_options defaults;
+    _bbm **prhs;
+    int *position, *changed;
+    int block, i;
+
+    if (opts == NULL)
+    {
+        default_rz_options(&defaults);
+        opts = &defaults;
+    }
+    if (batch->ale == NULL)
+        return solve_rz_batch(ctx, batch, system, weight, abort, opts);
+
+    clear_results(ctx);
+
+    //system block -> batch block
+    position = (int*) malloc(batch->nblocks * sizeof(int));
+    for (block = 0; block < batch->nblocks; block++)
+        position[batch->order[block]] = block;
+
+    //RHSs of changed blocks only, with the column transform of echelonize
+    prhs    = (_bbm**) calloc(batch->nblocks, sizeof(_bbm*));
+    changed = (int*) malloc((nchanged > 0 ? nchanged : 1) * sizeof(int));
+    for (i = 0; i < nchanged; i++)
+    {
+        block = position[blocks[i]];
+        changed[i] = block;
+        if (prhs[block] != NULL)
+            continue;
+        prhs[block] = build_rz_rhs_block(system, batch->order, block, opts);
+        transform_rz_rhs(batch, block, prhs[block]);
+    }
+    update_ales(batch->ale, batch->pbbm, prhs, batch->pA, changed, nchanged, (size_t) opts->lut_budget);
+
+    free(changed);
+    free_rz_rhs(prhs, batch->nblocks);
+    free(position);
+
+    ctx->rank = batch->rank;
+    return search_rz(ctx, batch->pbbm, batch->ale, weight, abort, opts);
+}
+
+/// cleanup
+void clear_rz_batch(RZ_batch *batch)
+{
+    if (batch->ale != NULL)
+        free_ales(batch->ale, batch->nblocks);
+    if (batch->images != NULL)
+    {
+        for (int block = 0; block < batch->nblocks; block++)
+            free(batch->images[block]);
+        free(batch->images);
+    }
+    if (batch->pA != NULL)
+        free_bbm(batch->pA);
+    if (batch->pbbm != NULL)
+        free_bbm(batch->pbbm);
+    free(batch->order);
+    batch->images = NULL;
+    batch->pA     = NULL;
+    batch->pbbm   = NULL;
+    batch->order  = NULL;
+    batch->ale    = NULL;
+}
+
+/// estimate of RZ search (solve_rz with same weight and opts) without solving
+/// random probes for maxt seconds, returns number of probes
+/// LUTs as in solve_rz (opts->lut_budget, opts->lazy: only LUTs of visited blocks are built)
+long long int estimate_rz(MRHS_context *ctx, MRHS_system *system, int weight, double maxt, SearchEstimate *est,
+                          const RZ_options *opts)
+{
+    ActiveListEntry* pActiveList;
+    RZ_options defaults;
+    _bbm *pbbm, **prhs, *pA = NULL;
+
+    memset(est, 0, sizeof(SearchEstimate));
+    if (opts == NULL)
+    {
+        default_rz_options(&defaults);
+        opts = &defaults;
+    }
+    if (system->nblocks == 0)
+        return 0;
+
+#if (_VERBOSITY > 1)
+    int rank =
+#endif
+               build_rz(system, opts, &pbbm, &prhs, &pA);
+#if (_VERBOSITY > 1)
+	fprintf(stdout, "Starting RZ estimate, system rank = %i\n", rank);
+#endif
+    //x_rows are not needed
+    if (opts->share)
+        pActiveList = prepare_shared(pbbm, prhs, (size_t) opts->lut_budget);
+    else if (opts->lazy)
+        pActiveList = prepare_lazy(pbbm, prhs, NULL, (size_t) opts->lut_budget);
+    else
+        pActiveList = prepare(pbbm, prhs, (size_t) opts->lut_budget);
+#if (_VERBOSITY > 1)
+    report_luts(pActiveList, pbbm);
+#endif
+
+    estimate_search(pActiveList, pbbm, weight, maxt, 0, &ctx->rng, est);
+#if (_VERBOSITY > 1)
+    report_built_luts(pActiveList, pbbm);
+#endif
+
+    free_ales(pActiveList, pbbm->nblocks);
+    clear_rz(pbbm, prhs, pA);
+
+    return est->probes;
+}
@@ -10,9 +10,73 @@
 
 #include "mrhs.bm.h"
 #include "mrhs.h"
+#include "mrhs.reorder.h"
+#include "mrhs.estimate.h"
+#include "mrhs.context.h"
+
+/// optional settings of the RZ solver
+typedef struct {
+    int threads;    // number of worker threads (1 = serial search)
+    int depth;      // split depth of parallel search (-1 = from cost model)
+    int reorder;    // block order: 0 = input order, 1 = greedy, > 1 = beam width
+    int swaps;      // max. passes of adjacent swaps after reordering
+    int cost;       // objective of reordering: ORDER_NTOTAL or ORDER_NXOR
+    const char *checkpoint;   // checkpoint file of serial search (NULL = none)
+    int checkpoint_interval;  // seconds between checkpoints
+    const char *resume;       // checkpoint to resume from (NULL = new search)
+    int shard, shards;        // search only part shard of shards (shards = 1: whole tree)
+    int progress;             // seconds between progress reports to stderr (0 = none)
+    const _block *rhs_offset; // per block: RHS rows are stored XOR offset, weight is of the original row (NULL = none)
+    long long lut_budget;     // max. bytes of dense LUT of one block, larger LUTs are sorted (see prepare)
+    int lazy;                 // LUT of each block is built when the search reaches it (solve_rz, no checkpoints)
+    int share;                // blocks with translated RHS sets share one LUT (see prepare_shared, not in batches)
+} RZ_options;
+
+/// default settings: serial search
+void default_rz_options(RZ_options *opts);
 
 //front end to non-recursive call
 //TODO: connect with MRHS RZ solver, refactor...
-long long int solve_rz(MRHS_system *system, _bv **pResults, int maxt, int weight, int abort, long long int* pCount, long long int* pXors);
+// opts == NULL: default settings
+// blocks are searched in the order from opts->reorder, solutions are not affected
+// results, counters, rank and transform of the system are stored to ctx (previous results are freed)
+// returns number of solutions, -1 if resume from opts->resume failed
+long long int solve_rz(MRHS_context *ctx, MRHS_system *system, int weight, int abort, const RZ_options *opts);
+
+/// M of a system prepared once for solving with many RHSs (batch solving)
+typedef struct {
+    int nblocks, nrows;     // blocks and variables of the system
+    int rank;               // rank of M
+    int *order;             // block order, system block of each block of pbbm
+    _bbm *pbbm;             // echelonized M in block order
+    _bbm *pA;               // transformation for extracting solutions
+    _block **images;        // images[b][j]: RHS vector with bit j of block b after echelonize
+    ActiveListEntry *ale;   // LUTs of the last solved RHSs (NULL = none)
+} RZ_batch;
+
+/// prepares M of system for solving with many RHSs: block order, echelon form,
+/// column transform of each block (opts->reorder, swaps, cost are used), returns rank
+int prepare_rz_batch(RZ_batch *batch, MRHS_system *system, const RZ_options *opts);
+
+/// solves system with M of the batch (only RHSs of system are used) as solve_rz
+/// LUTs stay in the batch for update_rz_batch
+/// PRE: system has the same M as the system of prepare_rz_batch
+long long int solve_rz_batch(MRHS_context *ctx, RZ_batch *batch, MRHS_system *system, int weight, int abort,
+                             const RZ_options *opts);
+
+/// solves system as solve_rz_batch, only LUTs of nchanged blocks (system block indices in blocks)
+/// are rebuilt, other blocks keep RHSs of the last solved system (no LUTs yet: solve_rz_batch)
+/// PRE: same opts as the last solve_rz_batch/update_rz_batch, RHSs of other blocks are unchanged
+long long int update_rz_batch(MRHS_context *ctx, RZ_batch *batch, MRHS_system *system, const int *blocks, int nchanged,
+                              int weight, int abort, const RZ_options *opts);
+
+/// cleanup
+void clear_rz_batch(RZ_batch *batch);
+
+/// estimate of RZ search (solve_rz with same weight and opts) without solving
+/// random probes from ctx->rng for maxt seconds, returns number of probes
+/// LUTs as in solve_rz (opts->lut_budget, opts->share, opts->lazy: only LUTs of visited blocks are built)
+long long int estimate_rz(MRHS_context *ctx, MRHS_system *system, int weight, double maxt, SearchEstimate *est,
+                          const RZ_options *opts);
 
 #endif //_SOLVER_H
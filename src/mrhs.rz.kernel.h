@@ -0,0 +1,303 @@
+/**********************************
+ * MRHS based solver
+ *
+ * RZ search kernel template, included by mrhs.1.7.c once per variant
+ * (no include guard on purpose)
+ *
+ * Parameters:
+ *   KERNEL_NAME     name of generated function
+ *   KERNEL_BL       words of u (blocklen), 0 = runtime value
+ *   KERNEL_ALIGNED  1: LUT index of each block lies in a single word of u
+ *   KERNEL_PLAIN    1: all LUTs dense and prepared, no monitor, serial (no pool), nodes of each level
+ *                   are not counted, max_weight does not bound the search (see plain_search)
+ *   KERNEL_SHARED   1: LUTs from prepare_shared, entries of the block are refs to the shared LUT,
+ *                   values are translated to the block, s_i * M from tables of pivot rows
+ *
+ * LUT index position in u is read from ale[block].word/.shift (see prepare)
+ **********************************/
+
+#ifndef KERNEL_BL
+#define KERNEL_BL 0
+#endif
+#ifndef KERNEL_ALIGNED
+#define KERNEL_ALIGNED 0
+#endif
+#ifndef KERNEL_PLAIN
+#define KERNEL_PLAIN 0
+#endif
+#ifndef KERNEL_SHARED
+#define KERNEL_SHARED 0
+#endif
+
+#if (KERNEL_BL > 0)
+#define K_BLOCKLEN KERNEL_BL
+#else
+#define K_BLOCKLEN blocklen
+#endif
+
+//search subtree at root, starting with cursors of ale[block], root <= block
+static long long int KERNEL_NAME(ActiveListEntry* ale, _bbm *pbbm, int root, int block, int weight,
+                       _block* sol_stack, long long int *pCount, long long int *pXors, int max_weight, int abort,
+                       sol_rep_fn_t report_solution, void *report_data, SearchPool *pool, SearchMonitor *monitor)
+{
+    long long int count = 0;
+    long long int xors = 0;
+    long long int total = 0;
+    int b;
+    _block index;
+    int slot;
+    TableEntry * active;
+    _block *nr, *or, *ar, value;  //new row, old row, active row, value from u
+    _block av;                    //value of active entry in the block
+    int aw;                       //weight of active entry in the block
+#if (KERNEL_SHARED)
+    int c, width;
+    _block y;
+#endif
+    int blocklen = GET_BL(pbbm->ncols);
+    int stride = ROW_STRIDE(K_BLOCKLEN);   //rows of u-stack
+#if (!KERNEL_PLAIN)
+    long long int next_call = (monitor != NULL) ? monitor->interval : 0;
+    long long int mark_count = 0, mark_total = 0, mark_xors = 0;  //counters at previous monitor call
+#endif
+
+    nr = or = sol_stack;
+    (void) blocklen;
+    (void) monitor;
+
+    (void) pool;
+
+    while (block >= root)
+    {
+#if (!KERNEL_PLAIN)
+        //parallel search: someone needs work, or early abort
+        if (pool != NULL && (pool->stop || pool->hungry > pool->count))
+        {
+            if (pool->stop)
+                break;
+            pool_donate(pool, ale, pbbm, root, block);
+        }
+
+        //periodic hook (progress, checkpoint), state is consistent here
+        if (monitor != NULL && total >= next_call)
+        {
+            next_call = total + monitor->interval;
+            b = call_monitors(monitor, ale, pbbm, block, weight, count - mark_count, total - mark_total, xors - mark_xors);
+            mark_count = count;
+            mark_total = total;
+            mark_xors  = xors;
+            if (b)
+                break;
+        }
+#endif
+
+        //no more to process
+#if (KERNEL_PLAIN)
+        if (ale[block].next >= ale[block].end)
+#else
+        if (ale[block].next >= ale[block].end  || weight > max_weight)
+#endif
+        {
+            //backtrack
+            block--;
+            if (block < root)
+                break;
+            weight -= ale[block].weight;
+            continue;
+        }
+        //prepare stack for next solution
+#if (KERNEL_SHARED)
+        aw = ale[block].refs[ale[block].next].weight;
+        active = &ale[block].entries[ale[block].refs[ale[block].next++].entry];
+        av = active->value ^ ale[block].xval;
+#else
+        active = &ale[block].entries[ale[block].next++];
+        aw = active->weight;
+        av = active->value;
+#endif
+
+        weight += aw;
+        ale[block].weight = aw;
+
+
+        //reporting
+        ++total;
+#if (!KERNEL_PLAIN)
+        ++ale[block].nodes;
+#endif
+
+        //are we at the end?
+        if (block == pbbm->nblocks - 1)
+        {
+#if (!KERNEL_PLAIN)
+            if (weight > max_weight)
+             {
+                 weight -= aw;
+                 //buckets are sorted by weight: the rest is not lighter
+                 ale[block].next = ale[block].end;
+                 continue;
+             }
+#endif
+             //solution found
+            ++count;
+
+            //recompute solution - finalne prepocitanie
+            ale[block].val = (ale[block].val & ale[block].mask) ^ av;
+
+            if (report_solution != NULL)
+            {
+#if (KERNEL_PLAIN)
+                if (!report_solution(count, pbbm, ale, weight, report_data) && abort == 1)
+                    break;
+#else
+                if (pool != NULL)
+                {
+                    if (!pool_report(pool, report_solution, report_data, pbbm, ale, weight) && abort == 1)
+                    {
+                        pool->stop = 1;
+                        break;
+                    }
+                }
+                else if (!report_solution(count, pbbm, ale, weight, report_data) && abort == 1)
+					break;
+#endif
+            }
+
+            weight -= aw;
+            continue;
+        }
+
+#if (!KERNEL_PLAIN)
+        //following blocks cannot fit into max_weight
+        if (weight + ale[block].rest > max_weight)
+        {
+            weight -= aw;
+            ale[block].next = ale[block].end;
+            continue;
+        }
+#endif
+
+        //no change required in solution if active.value == 0, else add sm
+        if (av == 0)
+        {
+            // ak je v pravej strane vo volnej casi same nuly tak sa neprepocitava riesenie
+            // u sa forwarduje
+            //recompute solution
+            ale[block].val = (ale[block].val& ale[block].mask)^av;
+
+            // ale block u je akokeby stack
+            ale[block+1].u = ale[block].u;
+            nr = ale[block].u;
+        }
+        else
+        {
+            // ale block u je akokeby stack
+            or = ale[block].u;
+            nr = or+stride;
+            ale[block+1].u = nr;
+
+            ale[block].val = (ale[block].val& ale[block].mask)^av;
+
+#if (KERNEL_SHARED)
+            //s_i * M = row of each table by SHARE_TABLE_BITS of y, rows hold words [from, to)
+            width = ale[block].to - ale[block].from;
+            y  = av >> ale[block].yshift;
+            ar = ale[block].slab + (size_t) (y & ((ONE << SHARE_TABLE_BITS) - 1)) * width;
+            if (width >= XOR_VECTOR)
+                xor_rows(nr + ale[block].from, or + ale[block].from, ar, width);
+            else
+                for (b = ale[block].from; b < ale[block].to; b++)
+                     nr[b] = or[b]^ar[b - ale[block].from];
+            for (c = 1, y >>= SHARE_TABLE_BITS; y != 0; c++, y >>= SHARE_TABLE_BITS)
+            {
+                if ((y & ((ONE << SHARE_TABLE_BITS) - 1)) == 0)
+                    continue;
+                ar = ale[block].slab + (size_t) ((c << SHARE_TABLE_BITS) + (int) (y & ((ONE << SHARE_TABLE_BITS) - 1))) * width;
+                if (width >= XOR_VECTOR)
+                    xor_rows(nr + ale[block].from, nr + ale[block].from, ar, width);
+                else
+                    for (b = ale[block].from; b < ale[block].to; b++)
+                         nr[b] ^= ar[b - ale[block].from];
+            }
+            for (b = ale[block].to; b < K_BLOCKLEN; b++)
+                 nr[b] = or[b];
+            //reporting: counted as if the whole row was added
+            xors += K_BLOCKLEN - ale[block].first;
+#else
+            //add to previous solution, before "block" all zeroes
+            // sm_row holds words [from, to), zeroes after to
+            ar = active->sm_row;
+
+            //add block to u
+#if (KERNEL_BL > 0 && KERNEL_BL < XOR_VECTOR)
+            //short u: copy whole row (unrolled), add stored part
+            for (b = 0; b < KERNEL_BL; b++)
+                 nr[b] = or[b];
+            for (b = active->from; b < active->to; b++)
+                 nr[b] ^= ar[b - active->from];
+#else
+            if (active->to - active->from >= XOR_VECTOR)
+                xor_rows(nr + active->from, or + active->from, ar, active->to - active->from);
+            else
+                for (b = active->from; b < active->to; b++)
+                     nr[b] = or[b]^ar[b - active->from];
+            for (b = active->to; b < K_BLOCKLEN; b++)
+                 nr[b] = or[b];
+#endif
+            //reporting: counted as if the whole row was added
+            xors += K_BLOCKLEN - active->first;
+#endif
+        }
+
+        block++;
+
+        //get LUT index from u at precomputed position
+#if (KERNEL_BL == 1)
+        value = nr[0] >> ale[block].shift;
+#elif (KERNEL_ALIGNED)
+        value = nr[ale[block].word] >> ale[block].shift;
+#else
+        value = (nr[ale[block].word]>>ale[block].shift)^ ((nr[ale[block].word+1]<<(MAXBLOCKSIZE-1-ale[block].shift))<<1);
+#endif
+        index = value & ale[block].mask; // kontrolna cast rozdelenej pravej strany v tej tabulke v novom bloku
+#if (KERNEL_PLAIN)
+        slot  = (int) index;        //dense LUT
+#else
+        if (ale[block].bucket == NULL)
+            load_lut(ale, block);       //lazy prepare: first visit of the block
+        slot  = LUT_BUCKET(&ale[block], index);
+#endif
+        ale[block].next = ale[block].bucket[slot]; // v loopoUp tabulke sa najdu volne vybery
+        ale[block].end  = ale[block].bucket[slot+1];
+
+    	ale[block].val = index;
+
+#if (!KERNEL_PLAIN)
+        //prune: lightest entry of the bucket + lower bound of the rest
+        if (weight + ale[block].minw[slot] + ale[block].rest > max_weight)
+            ale[block].next = ale[block].end;
+
+        //split point of parallel search: subtree becomes a task, backtrack
+        if (pool != NULL && block == pool->split)
+        {
+            if (ale[block].next < ale[block].end && weight <= max_weight)
+                pool_push(pool, ale, pbbm, block);
+            ale[block].next = ale[block].end;
+        }
+#endif
+    }
+    //all done, back to root
+    if (pCount != NULL)
+        *pCount += count;
+    if (pXors != NULL)
+        *pXors += xors;
+
+    return total;
+}
+
+#undef K_BLOCKLEN
+#undef KERNEL_NAME
+#undef KERNEL_BL
+#undef KERNEL_ALIGNED
+#undef KERNEL_PLAIN
+#undef KERNEL_SHARED
@@ -0,0 +1,399 @@
+/**********************************
+ * MRHS based solver
+ * (C) 2016 Pavol Zajac
+ *
+ * library file: parallel RZ search
+ *
+ * v1.8: OpenMP workers, subtrees at split depth as work items,
+ *       idle workers steal unexplored LUT siblings
+ *
+ * Compilation: -fopenmp (gcc), /openmp (MSVC), otherwise serial fallback
+ **********************************/
+
+#include <stdlib.h>
+#include <memory.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#include "mrhs.bm.h"
+#include "mrhs.simd.h"
+#include "mrhs.solver.h"
+
+//number of initial work items per thread, used when split depth is automatic
+#define TASKS_PER_THREAD 16
+//number of subtrees per shard (balance of sharded search)
+#define TASKS_PER_SHARD  64
+//polls of the pool by an idle worker before it gives up its time slice
+#define IDLE_SPINS       64
+
+////////////////////////////////////////////////////////////////////////////////
+// Task pool
+
+static void pool_lock(SearchPool *pool)
+{
+#ifdef _OPENMP
+    omp_set_lock((omp_lock_t*) pool->lock);
+#endif
+}
+
+static void pool_unlock(SearchPool *pool)
+{
+#ifdef _OPENMP
+    omp_unset_lock((omp_lock_t*) pool->lock);
+#endif
+}
+
+//PRE: lock is held
+static void push_task(SearchPool *pool, ActiveListEntry* ale, _bbm *pbbm, int depth, int next, int end)
+{
+    int i;
+    int blocklen = GET_BL(pbbm->ncols);
+    SearchTask *task;
+
+    if (pool->count == pool->size)
+    {
+        pool->size  = (pool->size == 0) ? 64 : 2*pool->size;
+        pool->tasks = (SearchTask*) realloc(pool->tasks, pool->size * sizeof(SearchTask));
+    }
+    task = &pool->tasks[pool->count];
+
+    task->depth   = depth;
+    task->weight  = 0;
+    task->vals    = (_block*) malloc((depth+1) * sizeof(_block));
+    task->weights = (int*) malloc((depth+1) * sizeof(int));
+    task->path    = (int*) malloc((depth+1) * sizeof(int));
+    task->u       = (_block*) malloc(blocklen * sizeof(_block));
+    for (i = 0; i < depth; i++)
+    {
+        task->vals[i]    = ale[i].val;
+        task->weights[i] = ale[i].weight;
+        task->path[i]    = ale[i].next - 1;
+        task->weight    += ale[i].weight;
+    }
+    //siblings at depth: only LUT index is fixed
+    task->vals[depth] = ale[depth].val & ale[depth].mask;
+    memcpy(task->u, ale[depth].u, blocklen * sizeof(_block));
+    task->next = next;
+    task->end  = end;
+
+    pool->count++;
+}
+
+static void free_task(SearchTask *task)
+{
+    free(task->vals);
+    free(task->weights);
+    free(task->path);
+    free(task->u);
+}
+
+/// push siblings [ale[depth].next, ale[depth].end) as a new task, cursor is left unchanged
+/// sharded search: only every shards-th subtree belongs to this process
+void pool_push(SearchPool *pool, ActiveListEntry* ale, _bbm *pbbm, int depth)
+{
+    pool_lock(pool);
+    if (pool->shards <= 1 || pool->pushed % pool->shards == pool->shard)
+        push_task(pool, ale, pbbm, depth, ale[depth].next, ale[depth].end);
+    pool->pushed++;
+    pool_unlock(pool);
+}
+
+/// move half of the shallowest unexplored siblings in [root, block] to the pool
+void pool_donate(SearchPool *pool, ActiveListEntry* ale, _bbm *pbbm, int root, int block)
+{
+    int depth, mid, weight = 0;
+
+    for (depth = 0; depth < root; depth++)
+        weight += ale[depth].weight;
+
+    //shallowest level = largest subtrees
+    // above block: current subtree is kept, so a single sibling can be given away
+    // at block: nothing is active yet, keep at least one entry
+    // buckets are sorted by weight: a level whose donated half starts with an entry cut by
+    //   max_weight is kept, otherwise both halves would visit a cut entry (serial search: one)
+    for (depth = root; depth <= block; depth++)
+    {
+        mid = ale[depth].next + (ale[depth].end - ale[depth].next)/2;
+        if (ale[depth].end - ale[depth].next >= (depth < block ? 1 : 2)
+            && weight + ENTRY_WEIGHT(&ale[depth], mid) + ale[depth].rest <= pool->max_weight)
+            break;
+        weight += ale[depth].weight;
+    }
+    if (depth > block)
+        return;
+
+    pool_lock(pool);
+    //someone else may have donated in the meantime
+    if (pool->hungry > pool->count)
+    {
+        push_task(pool, ale, pbbm, depth, mid, ale[depth].end);
+        ale[depth].end = mid;
+    }
+    pool_unlock(pool);
+}
+
+/// serialized solution reporting, returns result of report_solution
+int pool_report(SearchPool *pool, sol_rep_fn_t report_solution, void *report_data, _bbm *pbbm, ActiveListEntry* ale, int weight)
+{
+    int retval;
+    pool_lock(pool);
+    retval = report_solution(++pool->solutions, pbbm, ale, weight, report_data);
+    pool_unlock(pool);
+    return retval;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Workers
+
+//idle worker: poll the pool, after IDLE_SPINS polls let busy workers run
+static void idle_wait(int spins)
+{
+    if (spins < IDLE_SPINS)
+    {
+#ifdef _OPENMP
+        #pragma omp flush
+#endif
+        return;
+    }
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+//split depth from the cost model: first level with enough expected subtrees
+static int auto_split_depth(ActiveListEntry* ale, _bbm *pbbm, double tasks)
+{
+    int block;
+    double expected = 1;
+
+    for (block = 0; block < pbbm->nblocks - 1; block++)
+    {
+        //|S_j|*2^(pj-lj) of the article, from the actual LUT
+        expected *= lut_density(ale, block);
+
+        if (expected >= tasks)
+            return block + 1;
+    }
+    return pbbm->nblocks - 1;
+}
+
+//restore path of the task in private cursors, search the subtree
+static long long int run_task(SearchTask *task, ActiveListEntry* ale, _bbm *pbbm, _block *solstack,
+                              long long int *pCount, long long int *pXors, int weight, int abort,
+                              sol_rep_fn_t report_solution, void *report_data, SearchPool *pool, SearchMonitor *monitor)
+{
+    int i;
+    int blocklen = GET_BL(pbbm->ncols);
+
+    //lazy prepare: LUTs on the path were built by the split phase
+    for (i = 0; i <= task->depth; i++)
+        if (ale[i].bucket == NULL)
+            load_lut(ale, i);
+
+    for (i = 0; i < task->depth; i++)
+    {
+        ale[i].val    = task->vals[i];
+        ale[i].weight = task->weights[i];
+        //entry on the path stays active (next-1), no siblings
+        ale[i].next   = ale[i].end = task->path[i] + 1;
+    }
+    ale[task->depth].val  = task->vals[task->depth];
+    ale[task->depth].next = task->next;
+    ale[task->depth].end  = task->end;
+
+    memcpy(solstack, task->u, blocklen * sizeof(_block));
+    ale[task->depth].u = solstack;
+
+    return solve_it(ale, pbbm, task->depth, task->weight, solstack, pCount, pXors, weight, abort, report_solution, report_data, pool, monitor);
+}
+
+//parallel front end, threads share LUTs, each has own cursors and u-stack
+// subtrees at depth are initial work items, idle workers steal unexplored siblings
+// depth < 0: chosen from the cost model
+// shards > 1: only subtrees with (index % shards == shard) are searched,
+//             depth must not depend on threads, so that all shards agree
+//             nodes and XORs above depth are visited by every shard: not in the result, but in *pSplit/*pSplitXors
+long long int solve_parallel(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors, int weight, int abort, sol_rep_fn_t report_solution, void *report_data,
+                             int threads, int depth, int shard, int shards, SearchMonitor *monitor,
+                             long long int *pSplit, long long int *pSplitXors)
+{
+    long long int total = 0, split_total, split_xors = 0;
+    int blocklen = GET_BL(pbbm->ncols);
+    int i;
+    SearchPool pool;
+    ActiveListEntry* tmpl;
+#ifdef _OPENMP
+    omp_lock_t lock;
+#else
+    threads = 1;    //no threading support, serial search
+#endif
+
+    if (shards <= 1 && (threads <= 1 || pbbm->nblocks < 2))
+        return solve(ale, pbbm, pCount, pXors, weight, abort, report_solution, report_data, monitor);
+
+    if (pbbm->nblocks < 2)
+    {
+        //single block: nothing to split, shard 0 searches everything
+        if (pCount != NULL)
+            *pCount = 0;
+        return (shard == 0) ? solve(ale, pbbm, pCount, pXors, weight, abort, report_solution, report_data, monitor) : 0;
+    }
+
+    if (depth < 0)
+        depth = (shards > 1) ? auto_split_depth(ale, pbbm, (double) TASKS_PER_SHARD * shards)
+                             : auto_split_depth(ale, pbbm, (double) TASKS_PER_THREAD * threads);
+    if (depth < 1)
+        depth = 1;
+    if (depth > pbbm->nblocks - 1)
+        depth = pbbm->nblocks - 1;
+
+    memset(&pool, 0, sizeof(SearchPool));
+    pool.shard  = shard;
+    pool.shards = shards;
+    pool.max_weight = weight;
+#ifdef _OPENMP
+    omp_init_lock(&lock);
+    pool.lock = &lock;
+#endif
+
+    if (pCount != NULL)
+        *pCount = 0;
+
+    //split phase: search above depth, subtrees at depth go to the pool
+    {
+        _block* solstack = (_block*) calloc_aligned(pbbm->nblocks*ROW_STRIDE(blocklen) + 1, sizeof(_block));
+
+        pool.split = depth;
+        ale[0].u    = solstack;
+        ale[0].next = ale[0].bucket[LUT_BUCKET(&ale[0], 0)];
+        ale[0].end  = ale[0].bucket[LUT_BUCKET(&ale[0], 0) + 1];
+        ale[0].val  = 0;
+        split_total = solve_it(ale, pbbm, 0, 0, solstack, pCount, &split_xors, weight, abort, report_solution, report_data, &pool, monitor);
+        pool.split = -1;
+
+        //nodes above depth: part of the result of a single process, separate stats of shards
+        if (shards > 1)
+        {
+            if (pSplit != NULL)
+                *pSplit = split_total;
+            if (pSplitXors != NULL)
+                *pSplitXors = split_xors;
+        }
+        else
+        {
+            total = split_total;
+            if (pXors != NULL)
+                *pXors += split_xors;
+        }
+
+        free_aligned(solstack);
+    }
+
+    //cursors of the workers, copied before workers start (lazy prepare publishes LUTs to ale)
+    tmpl = (ActiveListEntry*) malloc(pbbm->nblocks * sizeof(ActiveListEntry));
+    memcpy(tmpl, ale, pbbm->nblocks * sizeof(ActiveListEntry));
+    for (i = 0; i < pbbm->nblocks; i++)
+    {
+        tmpl[i].nodes = 0;    //own counters of the worker
+        if (tmpl[i].lazy != NULL)
+            tmpl[i].bucket = NULL;    //lazy prepare: LUTs are taken by load_lut
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(threads) reduction(+:total)
+#endif
+    {
+        //private cursors and u-stack, LUTs are shared
+        ActiveListEntry* wale = (ActiveListEntry*) malloc(pbbm->nblocks * sizeof(ActiveListEntry));
+        _block* solstack = (_block*) calloc_aligned(pbbm->nblocks*ROW_STRIDE(blocklen) + 1, sizeof(_block));
+        long long int count = 0, xors = 0;
+        int waiting = 0, got, spins, b;
+        SearchTask task;
+
+        memcpy(wale, tmpl, pbbm->nblocks * sizeof(ActiveListEntry));
+
+        for (;;)
+        {
+            got = 0;
+            pool_lock(&pool);
+            if (pool.count > 0 && !pool.stop)
+            {
+                task = pool.tasks[--pool.count];
+                pool.busy++;
+                got = 1;
+            }
+            else if (pool.busy == 0 || pool.stop)
+            {
+                //nothing left to steal: done
+                if (waiting)
+                    pool.hungry--;
+                pool_unlock(&pool);
+                break;
+            }
+            if (got && waiting)
+            {
+                pool.hungry--;
+                waiting = 0;
+            }
+            else if (!got && !waiting)
+            {
+                //ask busy workers to donate
+                pool.hungry++;
+                waiting = 1;
+            }
+            pool_unlock(&pool);
+
+            if (!got)
+            {
+                //wait until something is donated or everybody is idle
+                for (spins = 0; pool.count == 0 && pool.busy > 0 && !pool.stop; spins++)
+                    idle_wait(spins);
+                continue;
+            }
+
+            total += run_task(&task, wale, pbbm, solstack, &count, &xors, weight, abort, report_solution, report_data, &pool, monitor);
+            free_task(&task);
+
+            pool_lock(&pool);
+            pool.busy--;
+            pool_unlock(&pool);
+        }
+
+        //merge per-thread counters
+#ifdef _OPENMP
+        #pragma omp critical
+#endif
+        {
+            if (pCount != NULL)
+                *pCount += count;
+            if (pXors != NULL)
+                *pXors += xors;
+            for (b = 0; b < pbbm->nblocks; b++)
+                ale[b].nodes += wale[b].nodes;    //nodes of each level since the last monitor call
+        }
+
+        free_aligned(solstack);
+        free(wale);
+    }
+
+    free(tmpl);
+
+    //leftovers after early abort
+    while (pool.count > 0)
+        free_task(&pool.tasks[--pool.count]);
+    free(pool.tasks);
+#ifdef _OPENMP
+    omp_destroy_lock(&lock);
+#endif
+
+    return total;
+}
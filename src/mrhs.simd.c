@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////
+// Vectorized row operations
+//
+// xor_rows variants: scalar, SSE2, AVX2, AVX-512, picked by CPUID
+
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "mrhs.bm.h"
+#include "mrhs.simd.h"
+
+//gcc/clang: compile single functions for given instruction set
+//MSVC: intrinsics are always available
+#if defined(__GNUC__)
+#define SIMD_TARGET(X) __attribute__((target(X)))
+#else
+#define SIMD_TARGET(X)
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Variants
+
+static void xor_rows_scalar(_block *dst, const _block *a, const _block *b, int len)
+{
+    int i;
+    for (i = 0; i < len; i++)
+        dst[i] = a[i]^b[i];
+}
+
+#ifdef SIMD_X86
+
+SIMD_TARGET("sse2")
+static void xor_rows_sse2(_block *dst, const _block *a, const _block *b, int len)
+{
+    int i;
+    for (i = 0; i + 2 <= len; i += 2)
+    {
+        _mm_store_si128((__m128i*) (dst+i),
+                        _mm_xor_si128(_mm_load_si128((const __m128i*) (a+i)),
+                                      _mm_load_si128((const __m128i*) (b+i))));
+    }
+    for ( ; i < len; i++)
+        dst[i] = a[i]^b[i];
+}
+
+SIMD_TARGET("avx2")
+static void xor_rows_avx2(_block *dst, const _block *a, const _block *b, int len)
+{
+    int i;
+    for (i = 0; i + 4 <= len; i += 4)
+    {
+        _mm256_store_si256((__m256i*) (dst+i),
+                           _mm256_xor_si256(_mm256_load_si256((const __m256i*) (a+i)),
+                                            _mm256_load_si256((const __m256i*) (b+i))));
+    }
+    for ( ; i < len; i++)
+        dst[i] = a[i]^b[i];
+}
+
+SIMD_TARGET("avx512f")
+static void xor_rows_avx512(_block *dst, const _block *a, const _block *b, int len)
+{
+    int i;
+    for (i = 0; i + 8 <= len; i += 8)
+    {
+        _mm512_store_si512((void*) (dst+i),
+                           _mm512_xor_si512(_mm512_load_si512((const void*) (a+i)),
+                                            _mm512_load_si512((const void*) (b+i))));
+    }
+    for ( ; i < len; i++)
+        dst[i] = a[i]^b[i];
+}
+
+////////////////////////////////////////////////////////////////////////
+// CPU detection
+
+#define SIMD_NONE     0
+#define SIMD_SSE2     1
+#define SIMD_AVX2     2
+#define SIMD_AVX512   3
+
+//best supported instruction set, including OS support of wide registers
+static int simd_level(void)
+{
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SIMD_SSE2;
+    return SIMD_NONE;
+#elif defined(_MSC_VER)
+    int info[4], level = SIMD_NONE;
+    unsigned long long xcr0 = 0;
+
+    __cpuid(info, 0);
+    if (info[0] < 1)
+        return SIMD_NONE;
+    __cpuid(info, 1);
+    if (info[3] & (1 << 26))
+        level = SIMD_SSE2;
+    //OSXSAVE + AVX: check that OS saves ymm/zmm registers
+    if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))
+        xcr0 = _xgetbv(0);
+
+    __cpuid(info, 0);
+    if (info[0] < 7 || (xcr0 & 0x6) != 0x6)
+        return level;
+    __cpuidex(info, 7, 0);
+    if (info[1] & (1 << 5))
+        level = SIMD_AVX2;
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+        level = SIMD_AVX512;
+    return level;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+#endif //SIMD_X86
+
+////////////////////////////////////////////////////////////////////////
+// Dispatch
+
+//first call selects the variant
+static void xor_rows_init(_block *dst, const _block *a, const _block *b, int len)
+{
+    init_xor_rows();
+    xor_rows(dst, a, b, len);
+}
+
+xor_rows_fn_t xor_rows = xor_rows_init;
+
+/// select variant now, returns its name
+const char* init_xor_rows(void)
+{
+#ifdef SIMD_X86
+    switch (simd_level())
+    {
+    case SIMD_AVX512:
+        xor_rows = xor_rows_avx512;
+        return "avx512";
+    case SIMD_AVX2:
+        xor_rows = xor_rows_avx2;
+        return "avx2";
+    case SIMD_SSE2:
+        xor_rows = xor_rows_sse2;
+        return "sse2";
+    }
+#endif
+    xor_rows = xor_rows_scalar;
+    return "scalar";
+}
@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////////////////
+// Vectorized row operations
+
+#ifndef _MRHS_SIMD_H
+#define _MRHS_SIMD_H
+
+#include "mrhs.bm.h"
+
+//words in one aligned vector chunk (64 bytes = one AVX-512 register)
+#define XOR_VECTOR   8
+
+//u rows and sm_rows of at least XOR_VECTOR words are stored aligned,
+// padded to multiple of XOR_VECTOR, shorter rows are packed
+#define ROW_STRIDE(X)  (((X) < XOR_VECTOR) ? (X) : ((X) + XOR_VECTOR - 1) / XOR_VECTOR * XOR_VECTOR)
+
+/// dst[i] = a[i] ^ b[i], i in [0, len)
+/// PRE: dst, a, b aligned to MEMORY_ALIGN, len multiple of XOR_VECTOR
+typedef void (*xor_rows_fn_t)(_block *dst, const _block *a, const _block *b, int len);
+
+/// variant selected by CPUID on first use (scalar, sse2, avx2, avx512)
+extern xor_rows_fn_t xor_rows;
+
+/// select variant now, returns its name
+const char* init_xor_rows(void);
+
+#endif //_MRHS_SIMD_H
@@ -30,13 +30,15 @@ typedef struct {
    int *pivots;      // number of pivots in each block (or special use)
    int nrows;        // number of rows
    int ncols;		   // total number of columns = sum of blocksizes
-   _block **rows;      // storage: array of nrows pointers to arrays of blocks
-   int* weights;     // hamming weight of RHS 
+   _block **rows;      // array of nrows pointers to rows in slab (row swaps exchange pointers)
+   _block *slab;       // storage: nrows rows of stride blocks, aligned to MEMORY_ALIGN
+   int stride;         // blocks between rows in slab, ROW_STRIDE(nblocks)
+   int* weights;     // hamming weight of RHS (NULL: none)
 } _bbm;
 
 /// Creates a dynamic BlockBitMatrix with nrows and nblocks, 
 ///   each with the same blocksize, blocks filled with zeroes
-/// alloc: array of pointers
+/// alloc: array of row pointers into one aligned slab
 /// PRE: nblocks > 0, 0 < blocksize <= MAXBLOCKSIZE, nrows > 0
 _bbm* create_bbm(int nrows, int nblocks, int blocksize);
 
@@ -50,43 +52,228 @@ void free_bbm(_bbm* pbbm);
 ///  swaps columns so that pivots form identity matrix at the start of block
 /// if rhs pointer is non-zero, swaps columns also in rhs(must have same blocks)
 /// NOTE: pivots are moved to MSB part, so that LSB part can be used as an index
+/// rows are reduced by tables of up to ECHELON_K pivot rows (Method of Four Russians), 
+///  with OpenMP the reduction of rows is split between threads
+/// if pA is non-zero, *pA is the transformation (A * M = echelon form), rows packed to blocks 
+///  of MAXBLOCKSIZE columns (column j is bit j % MAXBLOCKSIZE of block j / MAXBLOCKSIZE)
 int echelonize(_bbm *pbbm, _bbm *prhs[], _bbm **pA);
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Tables for computation
 
-typedef struct _te {
+typedef struct {
     _block   value;
-    _block  *sm_row;
+    _block  *sm_row;      //words [from, to) of s_i * M, stored in slab
     int  first;       //first non-zero index
+    int  from, to;    //stored part of sm_row, aligned for vector rows
     int  weight;      //original hamming weight of the RHS
-    struct _te *next;   
+    _block  *x_row;       //contribution of the entry to solution x (see prepare_x), NULL before
 } TableEntry;
 
+//entry of a shared LUT in a block (see prepare_shared)
+typedef struct {
+    int  entry;       //index to entries of the shared LUT
+    int  weight;      //original hamming weight of the RHS of the block
+} EntryRef;
+
+typedef struct LazyLUTs LazyLUTs;   //deferred LUTs (see prepare_lazy)
+typedef struct SharedLUTs SharedLUTs; //interned LUTs (see prepare_shared)
+
 typedef struct {
     _block  mask; 
-    TableEntry* *LUT;   //array of pointers
+    int    *bucket;       //LUT: entries of slot i are [bucket[i], bucket[i+1]) (slot: see LUT_BUCKET)
+    _block *keys;         //sorted LUT: index of each slot (NULL: dense LUT, slot = index)
+    int     nbuckets;     //number of slots (dense: mask + 1), bucket[nbuckets] = number of entries
+    TableEntry *entries;  //all entries of the block, grouped by index, lightest first
+    _block *slab;         //aligned storage of all sm_rows of the block (see ROW_STRIDE)
+    _block *x_slab;       //storage of all x_rows of the block
     _block* u;   
     _block  val;
-    TableEntry *next;
+    int     next, end;  //unexplored entries [next, end) of active bucket
+    int     weight;     //weight of the active entry (weight bounded search)
+    int     word, shift;  //position of LUT index in u
+    int     straddle;     //LUT index continues in word+1
+    int    *minw;         //min. weight of entries in each bucket (0 for empty)
+    int     rest;         //sum of min. weights of all following blocks
+    int     lightest;     //min. weight of entries of the block (-1: no entries)
+    long long int nodes;  //entries visited at this level (progress report, searches with monitor only)
+    LazyLUTs *lazy;       //LUT is built on first visit if bucket == NULL (NULL: prepared)
+    SharedLUTs *shared;   //bucket, keys and entries belong to the interned LUTs (NULL: to the block)
+    _block  xidx, xval;   //shared LUT: index and value of the block = index and value of the LUT ^ xidx/xval
+    EntryRef *refs;       //shared LUT: entries of each bucket in this block, lightest first (NULL: entries)
+    int     tables;       //shared LUT: s_i * M from tables of pivot rows in slab (see prepare_shared)
+    int     yshift;       //shared LUT: pivot part of value (y) is value >> yshift
+    int     first, from, to;  //shared LUT: first non-zero word and stored part [from, to) of table rows
 } ActiveListEntry;
 
+/// weight and value of entry i of the block (shared LUT: entry of refs[i], value translated to the block)
+#define ENTRY_WEIGHT(pale, i) ((pale)->refs != NULL ? (pale)->refs[i].weight : (pale)->entries[i].weight)
+#define ENTRY_VALUE(pale, i)  ((pale)->refs != NULL ? (pale)->entries[(pale)->refs[i].entry].value ^ (pale)->xval \
+                                                     : (pale)->entries[i].value)
+
+//rows of the tables of a block with shared LUT: table c, row v = xor of pivot rows c*w + bits of v
+#define SHARE_TABLE_BITS 4
+
+//LUT of a block is dense (2^r slots) if it is small, or fits the budget and is not much larger 
+// than the number of entries, otherwise only the non-empty indices are kept in a sorted array
+#define LUT_BUDGET       (256ll << 20)  //default max. bytes of dense LUT of one block
+#define LUT_DENSE_MIN    (64 << 10)     //LUTs up to this size are always dense
+#define LUT_SPARSE_RATIO 16             //sorted LUT if 2^r > LUT_SPARSE_RATIO * entries
+
+/// slot of LUT index in sorted LUT (binary search), nbuckets if there are no entries with index
+int find_bucket(const ActiveListEntry* pale, _block index);
+
+/// slot of entries with LUT index of the block, empty bucket [bucket[nbuckets], bucket[nbuckets+1]) if none
+#define LUT_BUCKET(pale, index) ((pale)->keys == NULL ? (int) ((index) ^ (pale)->xidx) : find_bucket((pale), (index) ^ (pale)->xidx))
+
 //PRE: pbbm and prhs prepared by echelonize
+/// budget: max. bytes of dense LUT of one block (see LUT_BUDGET)
 //TODO?: variable block sizes - this should already work 
 //WORKAROUND: allows variable number of rhs by removing duplicate entries
-ActiveListEntry* prepare(_bbm *pbbm, _bbm *prhs[]);
+ActiveListEntry* prepare(_bbm *pbbm, _bbm *prhs[], size_t budget);
 
 ///free memory allocated to lookup tables
 void free_ales(ActiveListEntry* ale, int count);
 
+/// as prepare, blocks with the same RHS set up to translation (S_j = S_i ^ t after echelonize) share
+/// one LUT of bucket offsets, keys and values, interned by the canonical translate of the set
+/// each block keeps its translation (xidx, xval), its order and weights of entries of each bucket (refs),
+/// min. weights of buckets, and tables of its pivot rows instead of sm_rows (one row xor per
+/// SHARE_TABLE_BITS pivots on descent), the search visits the same tree as with prepare
+//PRE: pbbm and prhs prepared by echelonize, no update_ales
+ActiveListEntry* prepare_shared(_bbm *pbbm, _bbm *prhs[], size_t budget);
+
+/// number of interned LUTs of the list (0: LUTs of blocks are not shared)
+int shared_luts(ActiveListEntry* ale);
+
+/// u ^= s_i * M of entry i of the block (stored part of the row), u: ROW_STRIDE(blocklen) words
+void add_entry_row(ActiveListEntry* pale, int i, _block *u);
+
+/// as prepare and prepare_x (pA != NULL), LUT of each block is built when the search reaches it,
+/// only the LUT of the first block is built at once
+//PRE: pbbm, prhs and pA are kept until free_ales, no checkpoints (they hash all LUTs)
+ActiveListEntry* prepare_lazy(_bbm *pbbm, _bbm *prhs[], _bbm *pA, size_t budget);
+
+/// builds LUT of ale[block] on the first visit (prepare_lazy), copies of the list get the shared LUT
+/// thread-safe: blocks are built one at a time
+void load_lut(ActiveListEntry* ale, int block);
+
+/// expected number of entries per LUT index of block (RHS of the block if LUT is not built yet)
+double lut_density(ActiveListEntry* ale, int block);
+
+/// solution x of each entry: y-part of the entry (pivot bits) times rows of A
+/// (shared LUT: pivot rows of A of the block, get_solution_x multiplies)
+//PRE: pA from echelonize of the same pbbm, ale from prepare or prepare_shared
+void prepare_x(ActiveListEntry* ale, _bbm *pbbm, _bbm *pA);
+
+/// rebuilds LUTs of nchanged blocks (indices in blocks) from prhs, other blocks are kept
+/// pA != NULL: x_rows of rebuilt blocks too (see prepare_x), budget as in prepare
+//PRE: ale from prepare of the same pbbm, prhs of the changed blocks transformed as by echelonize
+void update_ales(ActiveListEntry* ale, _bbm *pbbm, _bbm *prhs[], _bbm *pA, const int *blocks, int nchanged, size_t budget);
+
+/// solution x = xor of x_rows of entries on the path (ale[b].next-1 of each block)
+/// x: GET_NUM_BLOCKS(pbbm->nrows) words
+/// shared LUT: y of the entry in the block times its pivot rows of A
+//PRE: prepare_x, called from report_solution
+void get_solution_x(ActiveListEntry* ale, _bbm *pbbm, _block *x);
+
 ///Solver core function
-typedef int (*sol_rep_fn_t)(long long int counter, _bbm *pbbm, ActiveListEntry* ale, int weight);
+/// data: report_data given to the search (caller's state, e.g. result buffer)
+typedef int (*sol_rep_fn_t)(long long int counter, _bbm *pbbm, ActiveListEntry* ale, int weight, void *data);
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallel search: subtrees as work items
+
+/// unexplored LUT siblings at given depth, along with the path leading to them
+typedef struct {
+    int      depth;     // level of the siblings
+    int      weight;    // weight accumulated above depth
+    _block  *vals;      // ale[0..depth].val (at depth: LUT index only)
+    int     *weights;   // ale[0..depth-1].weight
+    int     *path;      // ale[0..depth-1].next-1, entries on the path (solution x)
+    _block  *u;         // u-vector at depth (blocklen words)
+    int      next, end; // siblings to explore
+} SearchTask;
+
+/// pool of tasks shared by all workers
+typedef struct {
+    SearchTask *tasks;      // stack of unexplored subtrees
+    volatile int count;     // number of tasks in the stack
+    int  size;              // allocated size of the stack
+    volatile int busy;      // workers processing a task
+    volatile int hungry;    // idle workers waiting for a task
+    volatile int stop;      // early abort, all workers quit
+    int  split;             // depth at which search emits tasks (-1: never)
+    int  max_weight;        // weight bound of the search (donation)
+    long long int solutions;    // global solution counter (reporting)
+    int  shard, shards;     // sharded search: keep subtrees with index % shards == shard
+    long long int pushed;   // subtrees emitted at split depth so far
+    void *lock;             // omp_lock_t
+} SearchPool;
+
+/// push siblings [ale[depth].next, ale[depth].end) as a new task, cursor is left unchanged
+/// sharded search: only every shards-th subtree belongs to this process
+void pool_push(SearchPool *pool, ActiveListEntry* ale, _bbm *pbbm, int depth);
+
+/// move half of the shallowest unexplored siblings in [root, block] to the pool
+void pool_donate(SearchPool *pool, ActiveListEntry* ale, _bbm *pbbm, int root, int block);
+
+/// serialized solution reporting, returns result of report_solution
+int pool_report(SearchPool *pool, sol_rep_fn_t report_solution, void *report_data, _bbm *pbbm, ActiveListEntry* ale, int weight);
+
+//visited nodes between two calls of monitors
+#define MONITOR_INTERVAL (1ll << 20)
+
+/// periodic hook of the search, called from the search loop every interval visited nodes
+/// fn gets the state at the top of the loop: cursors of ale[0..block],
+///   counters of the calling search since its previous call
+/// fn returns non-zero to stop the search
+/// parallel search: fn is called from all workers, each with its own ale
+typedef struct SearchMonitor {
+    long long int interval;
+    int (*fn)(struct SearchMonitor *monitor, ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+              long long int count, long long int total, long long int xors);
+    void *data;
+    struct SearchMonitor *next;     //chained monitor, uses the same interval
+} SearchMonitor;
+
+/// calls all chained monitors, returns non-zero if any of them stops the search
+int call_monitors(SearchMonitor *monitor, ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                  long long int count, long long int total, long long int xors);
+
+/// non-recursive search of subtree at ale[block], PRE: ale[0..block] prepared
+/// pool == NULL: serial search, monitor == NULL: no periodic hook
+long long int solve_it(ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                       _block* sol_stack, long long int *pCount, long long int *pXors, int max_weight, int abort,
+                       sol_rep_fn_t report_solution, void *report_data, SearchPool *pool, SearchMonitor *monitor);
+
+/// continue serial search of the whole tree from restored state at depth block
+/// PRE: ale[0..block] cursors, vals, weights and u restored, weight = sum of ale[0..block-1].weight
+long long int solve_from(ActiveListEntry* ale, _bbm *pbbm, int block, int weight,
+                         _block* sol_stack, long long int *pCount, long long int *pXors, int max_weight, int abort,
+                         sol_rep_fn_t report_solution, void *report_data, SearchMonitor *monitor);
+
+/// name of the search kernel used for prepared system and max_weight, hooked: parallel search or search with a monitor
+/// (plain kernels: all LUTs dense and prepared, serial search without monitor, nodes of each level
+///  are not counted, max_weight >= ncols; shared kernels: LUTs from prepare_shared)
+const char* get_kernel_name(ActiveListEntry* ale, _bbm *pbbm, int max_weight, int hooked);
 
 //front end to non-recursive call
-//TODO: for multiprocessing, fork can be used and new process created for each rhs
-//TODO: for threading, sol must be created for each rhs/thread 
-long long int solve(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors, int weight, int abort, sol_rep_fn_t report_solution);
+//multiprocessing: independent processes search disjoint shards, see solve_parallel
+// monitor == NULL: no periodic hook
+long long int solve(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors, int weight, int abort, sol_rep_fn_t report_solution, void *report_data,
+                    SearchMonitor *monitor);
+
+//parallel front end, threads share LUTs, each has own cursors and u-stack
+// subtrees at depth are initial work items, idle workers steal unexplored siblings
+// depth < 0: chosen from the cost model
+// shards > 1: only subtrees with (index % shards == shard) are searched,
+//             depth must not depend on threads, so that all shards agree
+//             nodes and XORs above depth are visited by every shard: not in the result, but in *pSplit/*pSplitXors
+long long int solve_parallel(ActiveListEntry* ale, _bbm *pbbm, long long int *pCount, long long int *pXors, int weight, int abort, sol_rep_fn_t report_solution, void *report_data,
+                             int threads, int depth, int shard, int shards, SearchMonitor *monitor,
+                             long long int *pSplit, long long int *pSplitXors);
 
 
 ///formula from article Ntotal
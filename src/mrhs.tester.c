@@ -24,6 +24,9 @@
 #include "mrhs.bv.h"
 #include "mrhs.hillc.h"
 #include "mrhs.rz.h"
+#include "mrhs.checkpoint.h"
+#include "mrhs.gd.h"
+#include "mrhs.context.h"
 //#include "opt.c"
 
 
@@ -42,6 +45,7 @@
 
 #define RZ_SOLVER_TYPE 1
 #define HC_SOLVER_TYPE 2
+#define ESTIMATE_SOLVER_TYPE 3
 
 //report: higher verbosity option
 //results: _VERBOSITY == 0 reporting of results
@@ -72,9 +76,7 @@ typedef struct {
   double t;
 } _stats;
 
-// Global pointer to experimental setup and stat reporting
-static _stats *gp_stats = NULL;
-// Sets gp_experiment to point to setup, and resets stats (count, total, xors, t)
+// Resets stats (count, total, xors, t)
 void init_stats(_stats *stats);
 
 //init stats
@@ -90,8 +92,6 @@ void init_stats(_stats *stats)
     stats->xor1     = 0.0;
     stats->xor2     = 0.0;
     stats->t        = 0.0;
-
-    gp_stats = stats;
 }
 
 /// ////////////////////////////////////////////////////////////////////
@@ -115,6 +115,21 @@ typedef struct {
   int andsys;   //special system based on PRNG
   int weight; //maximal allowed weight of result
   int abort; //early abort
+  int threads; //number of threads for RZ search
+  int depth;   //split depth for parallel RZ search
+  int reorder; //block order: 0 = input, 1 = greedy, > 1 = beam width
+  int swaps;   //passes of local swaps in block reordering
+  int cost;    //objective of block reordering
+  char *checkpoint; //checkpoint file of RZ search, CMD LINE --checkpoint
+  int checkpoint_interval; //seconds between checkpoints
+  char *resume;     //checkpoint to resume from, CMD LINE --resume
+  int shard, shards; //part of search space, CMD LINE --shard i/N
+  int progress;     //seconds between progress reports of RZ search, CMD LINE --progress
+  int guess;        //guessed variables before RZ search, CMD LINE --guess
+  char *batch;      //systems with the same M, solved with M prepared once, CMD LINE --batch
+  int lut_budget;   //max. MB of dense LUT of one block, CMD LINE --lut-budget
+  int lazy;         //LUTs are built when the search reaches a block, CMD LINE --lazy
+  int share;        //blocks with translated RHS sets share one LUT, CMD LINE --share-luts
 
   char *in;    // system  input file
   char *out;   // system output file
@@ -148,6 +163,8 @@ char* optarg;                /* argument associated with option */
 #define BADARG  (int)':'
 #define EMSG    ""
 
+static char* place = EMSG;              /* option letter processing */
+
 /*
 * getopt --
 *      Parse argc/argv argument vector.
@@ -155,7 +172,6 @@ char* optarg;                /* argument associated with option */
 int
 getopt(int nargc, char* const nargv[], const char* ostr)
 {
-    static char* place = EMSG;              /* option letter processing */
     const char* oli;                        /* option letter list index */
 
     if (optreset || !*place) {              /* update scanning pointer */
@@ -208,6 +224,57 @@ getopt(int nargc, char* const nargv[], const char* ostr)
     return (optopt);                        /* dump back option letter */
 }
 
+/*
+* long options: --name VALUE or --name=VALUE
+*/
+typedef struct {
+    const char* name;
+    int has_arg;
+    int val;                                /* returned by getopt_long */
+} long_option;
+
+/*
+* getopt_long --
+*      getopt, additionally matches "--name" against longopts.
+*/
+int
+getopt_long(int nargc, char* const nargv[], const char* ostr, const long_option* longopts)
+{
+    const char* name, * eq;
+    const long_option* lo;
+    size_t len;
+
+    if (optreset || !*place) {
+        if (optind < nargc && strncmp(nargv[optind], "--", 2) == 0 && nargv[optind][2] != '\0') {
+            name = nargv[optind++] + 2;
+            eq = strchr(name, '=');
+            len = (eq != NULL) ? (size_t)(eq - name) : strlen(name);
+            for (lo = longopts; lo->name != NULL; lo++)
+                if (strlen(lo->name) == len && strncmp(lo->name, name, len) == 0)
+                    break;
+            if (lo->name == NULL) {
+                if (opterr)
+                    (void)printf("illegal option -- %s\n", name);
+                return (BADCH);
+            }
+            optarg = NULL;
+            if (lo->has_arg) {
+                if (eq != NULL)
+                    optarg = (char*)eq + 1;
+                else if (optind < nargc)
+                    optarg = nargv[optind++];
+                else {
+                    if (opterr)
+                        (void)printf("option requires an argument -- %s\n", lo->name);
+                    return (BADCH);
+                }
+            }
+            return (lo->val);
+        }
+    }
+    return getopt(nargc, nargv, ostr);
+}
+
 
 
 
@@ -221,7 +288,9 @@ getopt(int nargc, char* const nargv[], const char* ostr)
 
 void help(char* fn)
 {
-    fprintf(HELP_FILE, "\nUsage: %s [-P] [-n N] [-m M] [-l L] [-k K] [-s SEED] [-w WEIGHT] [-a ABORT] [-S SED2] [-f FILE] [-o OUT] [-c] [-r] [-e TYPE] [-t MAXT] [-d DENS]\n", fn);
+    fprintf(HELP_FILE, "\nUsage: %s [-P] [-n N] [-m M] [-l L] [-k K] [-s SEED] [-w WEIGHT] [-a ABORT] [-S SED2] [-f FILE] [-o OUT] [-c] [-r] [-e TYPE] [-t MAXT] [-d DENS] [-j THREADS] [-D DEPTH] [-R BEAM] [-L SWAPS] [-C COST]\n", fn);
+    fprintf(HELP_FILE, "       [--checkpoint FILE] [--checkpoint-interval SECS] [--resume FILE] [--shard I/N] [--progress SECS] [--guess G] [--batch FILE]\n");
+    fprintf(HELP_FILE, "       [--lut-budget MB] [--lazy] [--share-luts]\n");
     fprintf(HELP_FILE, "   N = number of variables (def. 10)\n");
     fprintf(HELP_FILE, "   M = number of MRHS eqs  (def. 10)\n");
     fprintf(HELP_FILE, "   L = dimension of RHSs   (def. 3)\n");
@@ -233,9 +302,32 @@ void help(char* fn)
     fprintf(HELP_FILE, "WEIGHT = maximal weight of output (used in decoding)\n");
     fprintf(HELP_FILE, "ABORT = 1 for early abort 0 for full search\n");
     fprintf(HELP_FILE, "SED2 = randomness seed for computation\n\n");
+    fprintf(HELP_FILE, "THREADS = number of threads for RZ search (def. 1)\n");
+    fprintf(HELP_FILE, "DEPTH   = split depth for parallel RZ search (def. -1: from cost model)\n\n");
+    fprintf(HELP_FILE, "BEAM  = block reordering for RZ: 0=input order (def.), 1=greedy, >1=beam width\n");
+    fprintf(HELP_FILE, "SWAPS = max. passes of adjacent swaps after reordering (def. 0)\n");
+    fprintf(HELP_FILE, "COST  = reordering objective: %d=Ntotal (def.), %d=Nxor\n\n", ORDER_NTOTAL, ORDER_NXOR);
+    fprintf(HELP_FILE, "--checkpoint FILE = store state of RZ search to FILE (serial search only)\n");
+    fprintf(HELP_FILE, "--checkpoint-interval SECS = time between checkpoints (def. %d)\n", CHECKPOINT_INTERVAL);
+    fprintf(HELP_FILE, "--resume FILE = continue RZ search from checkpoint (same system and options)\n");
+    fprintf(HELP_FILE, "--shard I/N = search only part I (0..N-1) of RZ search tree, use the same -D in all parts\n");
+    fprintf(HELP_FILE, "              (solutions and stats of parts stored by -o OUT can be combined by mrhs-merge)\n");
+    fprintf(HELP_FILE, "--progress SECS = report progress of RZ search to stderr every SECS seconds (def. 0: none)\n");
+    fprintf(HELP_FILE, "--guess G = guess G variables, solve 2^G smaller systems by RZ (def. 0: none, max. %d)\n", GD_MAX_GUESS);
+    fprintf(HELP_FILE, "            (with --shard I/N the parts split the guesses)\n");
+    fprintf(HELP_FILE, "--batch FILE = solve all systems stored in FILE by RZ, they must have the same matrix M,\n");
+    fprintf(HELP_FILE, "               M is echelonized once, only RHSs are transformed for each system,\n");
+    fprintf(HELP_FILE, "               lookup tables are rebuilt only for blocks with RHSs changed from the previous system\n");
+    fprintf(HELP_FILE, "               (-o OUT: solutions of each system)\n");
+    fprintf(HELP_FILE, "--lut-budget MB = max. size of dense lookup table of one block (def. %lld), larger tables\n", LUT_BUDGET >> 20);
+    fprintf(HELP_FILE, "                  and tables much larger than the RHS are sorted arrays of non-empty buckets\n");
+    fprintf(HELP_FILE, "--lazy = build lookup table of a block when RZ search reaches it (not with checkpoints)\n");
+    fprintf(HELP_FILE, "--share-luts = one lookup table for blocks whose RHSs differ by a constant after echelonize,\n");
+    fprintf(HELP_FILE, "               blocks keep their weights and pivot rows (less memory, more XORs per node)\n\n");
     fprintf(HELP_FILE, "NOTE: -r enables enforcement of a (random) solution for generated systems \n\n");
 
-    fprintf(HELP_FILE, "TYPE = solver type: 0=no solver, %d=Raddum-Zajac, %d=HC\n", RZ_SOLVER_TYPE, HC_SOLVER_TYPE);
+    fprintf(HELP_FILE, "TYPE = solver type: 0=no solver, %d=Raddum-Zajac, %d=HC, %d=estimate of RZ (for MAXT seconds)\n",
+            RZ_SOLVER_TYPE, HC_SOLVER_TYPE, ESTIMATE_SOLVER_TYPE);
     fprintf(HELP_FILE, "NOTE: -c enables system compression (for HC) \n\n");
 
     fprintf(HELP_FILE, "FILE = file containing MRHS system \n      (if none, system is randomly generated using SEED)\n");
@@ -247,8 +339,6 @@ void help(char* fn)
     fprintf(HELP_FILE, "           ... \n");
     fprintf(HELP_FILE, "           Km VECTORS of size Lm   {vectors in m-th RHS} \n");
     fprintf(HELP_FILE, "        example VECTOR = [0 1 0 1 1 0] (size 6)\n\n");
-
-    //fprintf(stderr, "[-e] = if enabled, SW only estimates complexity, does not solve the system\n\n");
 }
 
 void set_default_experiment(_experiment *setup)
@@ -271,12 +361,54 @@ void set_default_experiment(_experiment *setup)
     setup->andsys = 0;  //not special PRNG system
     setup->weight = INT_MAX;
     setup->abort = 0;
+    setup->threads = 1;   //serial search
+    setup->depth   = -1;  //automatic split
+    setup->reorder = 0;   //input block order
+    setup->swaps   = 0;
+    setup->cost    = ORDER_NTOTAL;
+    setup->checkpoint = NULL;  //no checkpoints
+    setup->checkpoint_interval = CHECKPOINT_INTERVAL;
+    setup->resume     = NULL;
+    setup->shard  = 0;    //whole search space
+    setup->shards = 1;
+    setup->progress = 0;  //no progress report
+    setup->guess    = 0;  //no guessing
+    setup->batch    = NULL;
+    setup->lut_budget = (int) (LUT_BUDGET >> 20);
+    setup->lazy       = 0;
+    setup->share      = 0;
 
     setup->in    = NULL; //no input/output
     setup->out   = NULL;
     setup->fsols = NULL; //TODO...
 }
 
+//long options, codes above option letters
+#define OPT_CHECKPOINT           256
+#define OPT_CHECKPOINT_INTERVAL  257
+#define OPT_RESUME               258
+#define OPT_SHARD                259
+#define OPT_PROGRESS             260
+#define OPT_GUESS                261
+#define OPT_BATCH                262
+#define OPT_LUT_BUDGET           263
+#define OPT_LAZY                 264
+#define OPT_SHARE_LUTS           265
+
+static const long_option long_options[] = {
+    {"checkpoint",          1, OPT_CHECKPOINT},
+    {"checkpoint-interval", 1, OPT_CHECKPOINT_INTERVAL},
+    {"resume",              1, OPT_RESUME},
+    {"shard",               1, OPT_SHARD},
+    {"progress",            1, OPT_PROGRESS},
+    {"guess",               1, OPT_GUESS},
+    {"batch",               1, OPT_BATCH},
+    {"lut-budget",          1, OPT_LUT_BUDGET},
+    {"lazy",                0, OPT_LAZY},
+    {"share-luts",          0, OPT_SHARE_LUTS},
+    {NULL, 0, 0}
+};
+
 int parse_cmd(int argc, char *argv[], _experiment *setup)
 {
    int c;
@@ -284,7 +416,7 @@ int parse_cmd(int argc, char *argv[], _experiment *setup)
 
    set_default_experiment(setup);
 
-   while ((c = getopt (argc, argv, "Pcre:hk:l:m:n:s:w:a:S:f:o:t:d:")) != -1)
+   while ((c = getopt_long (argc, argv, "Pcre:hk:l:m:n:s:w:a:S:f:o:t:d:j:D:R:L:C:", long_options)) != -1)
       switch (c)
       {
       case 'k':
@@ -314,6 +446,57 @@ int parse_cmd(int argc, char *argv[], _experiment *setup)
       case 'S':
         sscanf(optarg, "%i", &(setup->seed2));
         break;
+      case 'j':
+        sscanf(optarg, "%i", &(setup->threads));
+        break;
+      case 'D':
+        sscanf(optarg, "%i", &(setup->depth));
+        break;
+      case 'R':
+        sscanf(optarg, "%i", &(setup->reorder));
+        break;
+      case 'L':
+        sscanf(optarg, "%i", &(setup->swaps));
+        break;
+      case 'C':
+        sscanf(optarg, "%i", &(setup->cost));
+        break;
+      case OPT_CHECKPOINT:
+        setup->checkpoint = optarg;
+        break;
+      case OPT_CHECKPOINT_INTERVAL:
+        sscanf(optarg, "%i", &(setup->checkpoint_interval));
+        break;
+      case OPT_RESUME:
+        setup->resume = optarg;
+        break;
+      case OPT_SHARD:
+        if (sscanf(optarg, "%i/%i", &(setup->shard), &(setup->shards)) != 2
+            || setup->shards < 1 || setup->shard < 0 || setup->shard >= setup->shards)
+        {
+            fprintf(HELP_FILE, "Invalid shard: %s\n", optarg);
+            help(argv[0]);
+            exit(1);
+        }
+        break;
+      case OPT_PROGRESS:
+        sscanf(optarg, "%i", &(setup->progress));
+        break;
+      case OPT_GUESS:
+        sscanf(optarg, "%i", &(setup->guess));
+        break;
+      case OPT_BATCH:
+        setup->batch = optarg;
+        break;
+      case OPT_LUT_BUDGET:
+        sscanf(optarg, "%i", &(setup->lut_budget));
+        break;
+      case OPT_LAZY:
+        setup->lazy = 1;
+        break;
+      case OPT_SHARE_LUTS:
+        setup->share = 1;
+        break;
       case 't':
         sscanf(optarg, "%lf", &(setup->maxt));
         break;
@@ -350,6 +533,7 @@ int prepare_system(MRHS_system *system, _experiment *setup)
 {
     FILE *f = NULL;
     FILE *fout = NULL;
+    _rng rng;
 
     //check I/O files
     if (setup->in != NULL)
@@ -375,7 +559,7 @@ int prepare_system(MRHS_system *system, _experiment *setup)
 		//create random system
 		if (setup->seed == -1)
 			setup->seed = time(0);
-		srand(setup->seed);
+		seed_rng(&rng, setup->seed);
 
 		//empty system:
         if (setup->andsys == 1)
@@ -391,26 +575,26 @@ int prepare_system(MRHS_system *system, _experiment *setup)
         if (setup->andsys == 1)
         {
             if (setup->d < 0)
-                fill_mrhs_and(system, setup->k, setup->l);
+                fill_mrhs_and(system, setup->k, setup->l, &rng);
             else
-                fill_mrhs_and_sparse(system, setup->k, setup->l, setup->d);
+                fill_mrhs_and_sparse(system, setup->k, setup->l, setup->d, &rng);
             
             setup->n = setup->m + setup->k - setup->l;
             setup->l = 3; setup->k = 4;
         }
 		else if (setup->d == -1)
 		{
-        	fill_mrhs_random(system);
+        	fill_mrhs_random(system, &rng);
         }
         else
         {
-        	fill_mrhs_random_sparse_extra(system, setup->d);
+        	fill_mrhs_random_sparse_extra(system, setup->d, &rng);
         }
 
         //do we require at least one random solution
         if (setup->randsol == 1)
 		{
-        	ensure_random_solution(system);
+        	ensure_random_solution(system, &rng);
         }
 	}
 
@@ -430,11 +614,218 @@ int prepare_system(MRHS_system *system, _experiment *setup)
 }
 
 
+//RZ solver settings from command line
+void set_rz_options(RZ_options *rzopts, _experiment *setup)
+{
+    default_rz_options(rzopts);
+    rzopts->threads = setup->threads;
+    rzopts->depth   = setup->depth;
+    rzopts->reorder = setup->reorder;
+    rzopts->swaps   = setup->swaps;
+    rzopts->cost    = setup->cost;
+    rzopts->checkpoint = setup->checkpoint;
+    rzopts->checkpoint_interval = setup->checkpoint_interval;
+    rzopts->resume     = setup->resume;
+    rzopts->shard      = setup->shard;
+    rzopts->shards     = setup->shards;
+    rzopts->progress   = setup->progress;
+    rzopts->lut_budget = (long long) setup->lut_budget << 20;
+    rzopts->lazy       = setup->lazy;
+    rzopts->share      = setup->share;
+}
+
+//report statistics of one run
+void report_stats(_experiment *setup, _stats *stats)
+{
+#if (_VERBOSITY > 0)
+    (void) setup;   //only the results line (_VERBOSITY == 0) reports the setup
+    fprintf(REPORT_FILE, "\nXORs: %lld Expected: %.0lf - %.0lf\n",
+               stats->xors, stats->xor2, stats->xor1);
+    fprintf(REPORT_FILE, "\nSolutions: %lld\nSearched %lld in %.3lf s, %e per sec\n",
+               stats->count, stats->total, stats->t, stats->total/stats->t);
+#endif
+
+#if (_VERBOSITY == 0)
+
+    //     SEED/SEED2   n   m   l  k rank count total time expected
+    fprintf(RESULTS_FILE, "%08x/%08x\t%i\t%i\t%i\t%i\t",
+		setup->seed,setup->seed2,setup->n, setup->m, setup->l, setup->k);
+    fprintf(RESULTS_FILE, "%i\t",
+		stats->rank);
+    fprintf(RESULTS_FILE, "%lld\t%lld\t%lf\t%.0lf\t",
+               stats->count, stats->total, stats->t, stats->expected);
+    fprintf(RESULTS_FILE, "%lld\t%.0lf\t%.0lf\n",
+               stats->xors, stats->xor2, stats->xor1);
+#endif
+}
+
+//same matrix M (blocks, sizes and rows), RHSs may differ
+static int same_matrix(MRHS_system *a, MRHS_system *b)
+{
+    if (a->nblocks != b->nblocks || a->pM[0].nrows != b->pM[0].nrows)
+        return 0;
+    for (int block = 0; block < a->nblocks; block++)
+        if (a->pM[block].ncols != b->pM[block].ncols
+            || memcmp(a->pM[block].rows, b->pM[block].rows, a->pM[block].nrows * sizeof(_block)) != 0)
+            return 0;
+    return 1;
+}
+
+//blocks with different RHSs in a and b (same M), stored to blocks, returns their number
+static int changed_blocks(MRHS_system *a, MRHS_system *b, int *blocks)
+{
+    int count = 0;
+    for (int block = 0; block < a->nblocks; block++)
+        if (a->pS[block].nrows != b->pS[block].nrows
+            || memcmp(a->pS[block].rows, b->pS[block].rows, a->pS[block].nrows * sizeof(_block)) != 0)
+            blocks[count++] = block;
+    return count;
+}
+
+//batch mode: systems of setup->batch share M, it is echelonized once (RZ_batch)
+// LUTs are rebuilt only for blocks with RHSs changed from the last solved instance
+int run_batch(_experiment *setup)
+{
+    FILE *f;
+    MRHS_system first, system, last;
+    MRHS_context ctx;
+    RZ_options rzopts;
+    RZ_batch batch;
+    _stats stats;
+    clock_t start;
+    int instance, solved = 0, nchanged, *changed;
+
+    if (setup->solver != RZ_SOLVER_TYPE || setup->guess > 0 || setup->compress)
+    {
+        fprintf(HELP_FILE, "Batch mode requires RZ solver without guessing and compression\n");
+        return -1;
+    }
+
+    f = fopen(setup->batch, "r");
+    if (f == NULL)
+    {
+        fprintf(HELP_FILE, "Invalid file name: %s\n", setup->batch);
+        return -2;
+    }
+    first = read_mrhs_variable(f);
+    if (first.nblocks == 0)
+    {
+        fprintf(HELP_FILE, "No system in %s\n", setup->batch);
+        clear_MRHS(&first);
+        fclose(f);
+        return -2;
+    }
+    if (setup->out != NULL)
+    {
+        setup->fsols = fopen(setup->out, "w");
+        if (setup->fsols == NULL)
+        {
+            fprintf(HELP_FILE, "Invalid file name: %s\n", setup->out);
+            clear_MRHS(&first);
+            fclose(f);
+            return -2;
+        }
+    }
+    setup->m = first.nblocks;
+    setup->n = first.pM[0].nrows;
+    setup->l = first.pS[0].ncols;
+    setup->k = first.pS[0].nrows;
+
+    if (setup->seed2 == -1)
+        setup->seed2 = time(0);
+    init_context(&ctx, setup->seed2);
+    set_rz_options(&rzopts, setup);
+    if (rzopts.checkpoint != NULL || rzopts.resume != NULL)
+    {
+        fprintf(HELP_FILE, "Checkpoints are not supported in batch mode, ignored\n");
+        rzopts.checkpoint = NULL;
+        rzopts.resume     = NULL;
+    }
+
+    start = clock();
+    prepare_rz_batch(&batch, &first, &rzopts);
+#if (_VERBOSITY > 0)
+    fprintf(REPORT_FILE, "Batch: %s, n = %i, m = %i, rank = %i, M prepared in %.3lf s\n", setup->batch,
+            setup->n, setup->m, batch.rank, (clock() - start)/(double)CLOCKS_PER_SEC);
+#endif
+
+    changed = (int*) malloc(first.nblocks * sizeof(int));
+    system  = first;
+    last    = first;
+    for (instance = 0; system.nblocks > 0; instance++)
+    {
+        if (!same_matrix(&first, &system))
+        {
+            fprintf(HELP_FILE, "Instance %i: matrix differs from the first system, skipped\n", instance);
+            clear_MRHS(&system);
+        }
+        else
+        {
+#if (_VERBOSITY > 0)
+            fprintf(REPORT_FILE, "\nInstance %i\n", instance);
+#endif
+            init_stats(&stats);
+            start = clock();
+            if (solved)
+            {
+                nchanged = changed_blocks(&last, &system, changed);
+#if (_VERBOSITY > 1)
+                fprintf(REPORT_FILE, "Changed blocks: %i\n", nchanged);
+#endif
+                stats.count = update_rz_batch(&ctx, &batch, &system, changed, nchanged,
+                                              setup->weight, setup->abort, &rzopts);
+            }
+            else
+                stats.count = solve_rz_batch(&ctx, &batch, &system, setup->weight, setup->abort, &rzopts);
+            stats.t     = (clock() - start)/(double)CLOCKS_PER_SEC;
+            //reported as solve_rz: xors -> visited nodes, total -> xors
+            stats.rank  = ctx.rank;
+            stats.xors  = ctx.total;
+            stats.total = ctx.xors;
+
+            if (setup->fsols != NULL)
+            {
+                fprintf(setup->fsols, "\n# instance %i solutions %lld", instance, stats.count);
+                for (long long int i = 0; i < ctx.nresults; i++)
+                {
+                    fprintf(setup->fsols, "\nx ");
+                    print_bv(&ctx.results[i], setup->fsols);
+                }
+            }
+            report_stats(setup, &stats);
+
+            //RHSs of system are in the LUTs now
+            if (last.pS != first.pS)
+                clear_MRHS(&last);
+            last   = system;
+            solved = 1;
+        }
+        system = read_mrhs_variable(f);
+    }
+    clear_MRHS(&system);
+    if (last.pS != first.pS)
+        clear_MRHS(&last);
+    free(changed);
+
+    if (setup->fsols != NULL)
+    {
+        fprintf(setup->fsols, "\n");
+        fclose(setup->fsols);
+    }
+    fclose(f);
+    clear_rz_batch(&batch);
+    clear_context(&ctx);
+    clear_MRHS(&first);
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
 	//working with this system
     MRHS_system system;
-    _bv *results = NULL;
+
+    //solver state: results, counters, random generator
+    MRHS_context ctx;
 
     //input settings: variables, equations, equation "degree", num rhs
     _experiment experiment;
@@ -442,6 +833,10 @@ int main(int argc, char* argv[])
     //output statistics:
     _stats stats;
 
+    //RZ solver settings
+    RZ_options rzopts;
+    SearchEstimate estimate;
+
     //time and IO
     clock_t start, end;
 
@@ -449,6 +844,9 @@ int main(int argc, char* argv[])
     if (!parse_cmd(argc, argv, &experiment))
 		return -1;
 
+	if (experiment.batch != NULL)
+		return run_batch(&experiment);
+
  	if (!prepare_system(&system, &experiment))
 		return -2;
 
@@ -458,7 +856,7 @@ int main(int argc, char* argv[])
     //init random generator for experiments
     if (experiment.seed2 == -1)
         experiment.seed2 = time(0);
-    srand(experiment.seed2);
+    init_context(&ctx, experiment.seed2);
 
 #if (_VERBOSITY > 0)
     fprintf(REPORT_FILE, "Experimental setup, SEED = %08x, SEED2 = %08x \n", experiment.seed, experiment.seed2);
@@ -468,6 +866,10 @@ int main(int argc, char* argv[])
     fprintf(REPORT_FILE, "Num equations m = %i \n", experiment.m);
     fprintf(REPORT_FILE, "Block length  l = %i \n", experiment.l);
     fprintf(REPORT_FILE, "Block size    k = %i \n", experiment.k);
+    if (experiment.threads > 1)
+        fprintf(REPORT_FILE, "Threads       j = %i \n", experiment.threads);
+    if (experiment.shards > 1)
+        fprintf(REPORT_FILE, "Shard           = %i/%i \n", experiment.shard, experiment.shards);
 #endif
 
 #if (_VERBOSITY > 2)
@@ -515,74 +917,86 @@ int main(int argc, char* argv[])
         switch (experiment.solver)
         {
         case HC_SOLVER_TYPE:
-            stats.count = solve_hc(&system, &results, experiment.maxt, &stats.xors, &stats.total);
+            stats.count = solve_hc(&ctx, &system, experiment.maxt);
+            stats.xors  = ctx.xors;
+            stats.total = ctx.total;
             break;
         case RZ_SOLVER_TYPE:
-            stats.count = solve_rz(&system, &results, experiment.maxt, experiment.weight, experiment.abort, &stats.xors, &stats.total);
+            set_rz_options(&rzopts, &experiment);
+            if (experiment.guess > 0)
+                stats.count = solve_gd(&ctx, &system, experiment.guess, experiment.weight, experiment.abort, &rzopts);
+            else
+                stats.count = solve_rz(&ctx, &system, experiment.weight, experiment.abort, &rzopts);
+            //reported as before: xors -> visited nodes, total -> xors
+            stats.rank  = ctx.rank;
+            stats.xors  = ctx.total;
+            stats.total = ctx.xors;
+            break;
+        case ESTIMATE_SOLVER_TYPE:
+            //same block order and LUTs as -e 1
+            set_rz_options(&rzopts, &experiment);
+            //no solving: total -> number of probes, estimates in expected, xor1 and xor2
+            stats.total    = estimate_rz(&ctx, &system, experiment.weight, experiment.maxt, &estimate, &rzopts);
+            stats.expected = estimate.nodes;
+            stats.xor1     = stats.xor2 = estimate.xors;
+#if (_VERBOSITY > 0)
+            fprintf(REPORT_FILE, "\nEstimate from %lld probes (95%% confidence):\n", estimate.probes);
+            fprintf(REPORT_FILE, "Searched:  %.4e +- %.2e\n", estimate.nodes, estimate.nodes_ci);
+            fprintf(REPORT_FILE, "XORs:      %.4e +- %.2e\n", estimate.xors, estimate.xors_ci);
+            fprintf(REPORT_FILE, "Solutions: %.4e +- %.2e\n", estimate.count, estimate.count_ci);
+#endif
             break;
         }
 	}
 	end = clock();
 	stats.t= (end-start)/(double)CLOCKS_PER_SEC;
 
+#if (_VERBOSITY > 0)
+	//sharded RZ: nodes above split depth are searched by every shard, not in its counters
+	if (ctx.split > 0)
+		fprintf(REPORT_FILE, "\nSplit phase (every shard): %lld nodes, %lld XORs\n", ctx.split, ctx.split_xors);
+#endif
+
 	// post processing: report results and clear data structures
 
-	if (experiment.fsols != NULL && results != NULL)
+	if (experiment.fsols != NULL)
 	{
-		for (int i = 0; i < stats.count; i++)
+		for (long long int i = 0; i < ctx.nresults; i++)
 		{
 			fprintf(experiment.fsols, "\nx ");
-			print_bv(&results[i], experiment.fsols);
+			print_bv(&ctx.results[i], experiment.fsols);
 		}
 
 	}
 	if (experiment.fsols != NULL)
 	{
+		//stats of the part, combined by mrhs-merge
+		// split: part above split depth, same in all shards, columns as searched/xors of stats
+		if (experiment.shards > 1)
+			fprintf(experiment.fsols, "\n# shard %i/%i solutions %lld searched %lld xors %lld time %.3lf split %lld %lld\n",
+				experiment.shard, experiment.shards, stats.count, stats.total, stats.xors, stats.t,
+				ctx.split_xors, ctx.split);
 		fclose(experiment.fsols);
 	}
 
-	if (results != NULL)
+#if (_VERBOSITY > 1)
+	if (ctx.nresults > 0)
 	{
-
-		for (int i = 0; i < stats.count; i++)
+		for (long long int i = 0; i < ctx.nresults; i++)
 		{
-#if (_VERBOSITY > 1)
 			//fprintf(REPORT_FILE, "\nSolution %i: ", i+1);
 			fprintf(REPORT_FILE, "\n");
-			print_bv(&results[i], REPORT_FILE);
-#endif
-			clear_bv(&results[i]);
+			print_bv(&ctx.results[i], REPORT_FILE);
 		}
-#if (_VERBOSITY > 1)
 		fprintf(REPORT_FILE, "\n");
-#endif
-
-		free(results);
 	}
+#endif
+	clear_context(&ctx);
 
 	clear_MRHS(&system);
 
 	// post processing, report statistics
-
-#if (_VERBOSITY > 0)
-    fprintf(REPORT_FILE, "\nXORs: %lld Expected: %.0lf - %.0lf\n",
-               stats.xors, stats.xor2, stats.xor1);
-    fprintf(REPORT_FILE, "\nSolutions: %lld\nSearched %lld in %.3lf s, %e per sec\n",
-               stats.count, stats.total, stats.t, stats.total/stats.t);
-#endif
-
-#if (_VERBOSITY == 0)
-
-    //     SEED/SEED2   n   m   l  k rank count total time expected
-    fprintf(RESULTS_FILE, "%08x/%08x\t%i\t%i\t%i\t%i\t",
-		experiment.seed,experiment.seed2,experiment.n, experiment.m, experiment.l, experiment.k);
-    fprintf(RESULTS_FILE, "%i\t",
-		stats.rank);
-    fprintf(RESULTS_FILE, "%lld\t%lld\t%lf\t%.0lf\t",
-               stats.count, stats.total, stats.t, stats.expected);
-    fprintf(RESULTS_FILE, "%lld\t%.0lf\t%.0lf\n",
-               stats.xors, stats.xor2, stats.xor1);
-#endif
+	report_stats(&experiment, &stats);
 
     //system("pause");
     return 0;